@@ -0,0 +1,553 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Benchmarks for the public functions of the library.
+ *
+ * Usage: bench [-n samples] [-o file.json] [name...]
+ *
+ * Functions on byte strings are timed over sizes from 16 bytes to 16 MiB, the
+ * others per operation. Each measurement is warmed up and calibrated so that
+ * one sample takes a few milliseconds, and the median of the samples is
+ * reported. Functions with several implementations are run once with all the
+ * CPU features in use and once with the portable code.
+ *
+ * A summary is printed to stderr, and all samples are written as JSON to the
+ * given file, or to stdout. If names are given, only benchmarks whose name
+ * starts with one of them are run. Cycle counts come from the time stamp
+ * counter, which may not tick at the core clock. */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "include/nectar.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define HAVE_RDTSC
+#endif
+
+
+/* Range of sizes, in bytes, multiplied by 4 at each step. */
+#define MIN_SIZE  16
+#define MAX_SIZE  (16 << 20)
+
+/* Target duration of one sample, in nanoseconds. */
+#define SAMPLE_NS  2000000
+
+/* Default and maximum number of samples. */
+#define SAMPLES      15
+#define MAX_SAMPLES  1001
+
+/* Rounds used for PBKDF2, and batch sizes. */
+#define ROUNDS  1000
+#define BATCH   64
+
+/* Length of the long messages signed with Ed25519. */
+#define LONG  65536
+
+/* Number of keys in the hash table, and of blocks in the Bloom filter (1 MiB,
+ * so that lookups miss the cache as they would in a real filter). */
+#define HTABLE  4096
+#define BLOOM   16384
+
+
+/* A benchmark, called `reps` times in a row for each sample. `size` is the
+ * length of the input for byte string functions, and 0 otherwise. */
+struct bench {
+    const char * name;
+    void (*fn)(size_t size);
+    int sized;
+    int dispatch;
+};
+
+/* Backends that functions with several implementations are run on. */
+static const struct {
+    const char * name;
+    uint32_t mask;
+} backends[] = {
+    { "native",   ~(uint32_t) 0 },
+    { "portable", 0 },
+};
+
+
+/* Shared inputs and outputs. */
+static uint8_t * in;
+static uint8_t * out;
+static uint8_t key[32];
+static uint8_t priv[BATCH * 32];
+static uint8_t pub[BATCH * 32];
+static uint8_t xpub[BATCH * 32];
+static uint8_t sign[BATCH * 64];
+static uint8_t msg[BATCH][64];
+static const uint8_t * msgs[BATCH];
+static size_t lens[BATCH];
+static int results[BATCH];
+static uint64_t hashes[BATCH];
+static uint8_t long_sign[64];
+static uint8_t ph_sign[64];
+static const uint8_t * bufs0[BATCH];
+static const uint8_t * bufs1[BATCH];
+static uint8_t hkeys[HTABLE][16];
+static uint8_t bloom_mem[64 * (BLOOM + 1)];
+static struct nectar_ed25519_sk sk;
+static struct nectar_ed25519_pk pk;
+static struct nectar_curve25519_precomp pre;
+static struct nectar_htable ht;
+static struct nectar_bloom bf;
+
+
+static void bench_chacha20(size_t size) {
+    struct nectar_chacha20_ctx cx;
+
+    nectar_chacha20_init(&cx, key, key);
+    nectar_chacha20_xor(&cx, out, in, size);
+}
+
+static void bench_poly1305(size_t size) {
+    struct nectar_poly1305_ctx cx;
+
+    nectar_poly1305_init(&cx, key);
+    nectar_poly1305_update(&cx, in, size);
+    nectar_poly1305_final(&cx, out, 16);
+}
+
+static void bench_sha512(size_t size) {
+    struct nectar_sha512_ctx cx;
+
+    nectar_sha512_init(&cx);
+    nectar_sha512_update(&cx, in, size);
+    nectar_sha512_final(&cx, out, 64);
+}
+
+static void bench_hmac_sha512(size_t size) {
+    struct nectar_hmac_sha512_ctx cx;
+
+    nectar_hmac_sha512_init(&cx, key, 32);
+    nectar_hmac_sha512_update(&cx, in, size);
+    nectar_hmac_sha512_final(&cx, out, 64);
+}
+
+static void bench_siphash(size_t size) {
+    hashes[0] = nectar_siphash(key, in, size);
+}
+
+static void bench_bcmp(size_t size) {
+    results[0] = nectar_bcmp(in, out, size);
+}
+
+static void bench_hchacha20(size_t size) {
+    nectar_hchacha20(out, key, in);
+}
+
+static void bench_pbkdf2(size_t size) {
+    nectar_pbkdf2_sha512(out, 64, key, 16, in, 16, ROUNDS);
+}
+
+static void bench_siphash_batch(size_t size) {
+    nectar_siphash_batch(key, msgs, lens, hashes, BATCH);
+}
+
+static void bench_bcmp_batch(size_t size) {
+    hashes[0] = nectar_bcmp_batch(bufs0, bufs1, 64, BATCH);
+}
+
+static void bench_htable_put(size_t size) {
+    struct nectar_htable t;
+    size_t i;
+
+    nectar_htable_init(&t, key);
+    for (i = 0; i < HTABLE; i++)
+        nectar_htable_put(&t, hkeys[i], 16, hkeys[i]);
+    nectar_htable_free(&t);
+}
+
+static void bench_htable_get(size_t size) {
+    size_t i;
+
+    for (i = 0; i < HTABLE; i++)
+        results[0] = nectar_htable_get(&ht, hkeys[i], 16, NULL);
+}
+
+static void bench_bloom_insert_batch(size_t size) {
+    nectar_bloom_insert_batch(&bf, msgs, lens, BATCH);
+}
+
+static void bench_bloom_query(size_t size) {
+    results[0] = nectar_bloom_query(&bf, msg[0], 64);
+}
+
+static void bench_bloom_query_batch(size_t size) {
+    nectar_bloom_query_batch(&bf, msgs, lens, results, BATCH);
+}
+
+static void bench_x25519_base(size_t size) {
+    nectar_curve25519_scalarmult_base(out, priv);
+}
+
+static void bench_x25519(size_t size) {
+    nectar_curve25519_scalarmult(out, priv, xpub);
+}
+
+static void bench_x25519_batch(size_t size) {
+    nectar_curve25519_scalarmult_batch(out, priv, xpub, BATCH);
+}
+
+static void bench_x25519_precompute(size_t size) {
+    nectar_curve25519_precompute(&pre, xpub);
+}
+
+static void bench_x25519_precomp(size_t size) {
+    nectar_curve25519_scalarmult_precomp(out, priv, &pre);
+}
+
+static void bench_ed25519_pubkey(size_t size) {
+    nectar_ed25519_pubkey(out, priv);
+}
+
+static void bench_ed25519_pubkey_batch(size_t size) {
+    nectar_ed25519_pubkey_batch(out, priv, BATCH);
+}
+
+static void bench_ed25519_sign(size_t size) {
+    nectar_ed25519_sign(out, msg[0], 64, pub, priv);
+}
+
+static void bench_ed25519_sign_expanded(size_t size) {
+    nectar_ed25519_sign_expanded(out, msg[0], 64, &sk);
+}
+
+static void bench_ed25519_sign_long(size_t size) {
+    nectar_ed25519_sign_expanded(out, in, LONG, &sk);
+}
+
+static void bench_ed25519_expand(size_t size) {
+    nectar_ed25519_expand(&sk, priv);
+}
+
+static void bench_ed25519_decompress(size_t size) {
+    nectar_ed25519_decompress(&pk, pub);
+}
+
+static void bench_ed25519_verify(size_t size) {
+    results[0] = nectar_ed25519_verify(sign, msg[0], 64, pub);
+}
+
+static void bench_ed25519_verify_long(size_t size) {
+    results[0] = nectar_ed25519_verify(long_sign, in, LONG, pub);
+}
+
+static void bench_ed25519_verify_decompressed(size_t size) {
+    results[0] = nectar_ed25519_verify_decompressed(sign, msg[0], 64, &pk);
+}
+
+static void bench_ed25519_verify_batch(size_t size) {
+    nectar_ed25519_verify_batch(results, sign, msgs, lens, pub, BATCH);
+}
+
+static void bench_ed25519ph_sign(size_t size) {
+    nectar_ed25519ph_sign(out, msg[0], 64, &sk);
+}
+
+static void bench_ed25519ph_verify(size_t size) {
+    results[0] = nectar_ed25519ph_verify(ph_sign, msg[0], 64, pub);
+}
+
+static const struct bench benches[] = {
+    { "chacha20",                    bench_chacha20,                    1, 0 },
+    { "poly1305",                    bench_poly1305,                    1, 0 },
+    { "sha512",                      bench_sha512,                      1, 0 },
+    { "hmac_sha512",                 bench_hmac_sha512,                 1, 0 },
+    { "siphash",                     bench_siphash,                     1, 0 },
+    { "bcmp",                        bench_bcmp,                        1, 0 },
+    { "hchacha20",                   bench_hchacha20,                   0, 0 },
+    { "pbkdf2_sha512/1000",          bench_pbkdf2,                      0, 0 },
+    { "siphash_batch/64",            bench_siphash_batch,               0, 1 },
+    { "bcmp_batch/64",               bench_bcmp_batch,                  0, 0 },
+    { "htable_put/4096",             bench_htable_put,                  0, 0 },
+    { "htable_get/4096",             bench_htable_get,                  0, 0 },
+    { "bloom_insert_batch/64",       bench_bloom_insert_batch,          0, 1 },
+    { "bloom_query",                 bench_bloom_query,                 0, 0 },
+    { "bloom_query_batch/64",        bench_bloom_query_batch,           0, 1 },
+    { "x25519_base",                 bench_x25519_base,                 0, 1 },
+    { "x25519",                      bench_x25519,                      0, 1 },
+    { "x25519_batch/64",             bench_x25519_batch,                0, 1 },
+    { "x25519_precompute",           bench_x25519_precompute,           0, 1 },
+    { "x25519_precomp",              bench_x25519_precomp,              0, 1 },
+    { "ed25519_pubkey",              bench_ed25519_pubkey,              0, 1 },
+    { "ed25519_pubkey_batch/64",     bench_ed25519_pubkey_batch,        0, 1 },
+    { "ed25519_sign",                bench_ed25519_sign,                0, 1 },
+    { "ed25519_sign_expanded",       bench_ed25519_sign_expanded,       0, 1 },
+    { "ed25519_sign_expanded/64k",   bench_ed25519_sign_long,           0, 1 },
+    { "ed25519_expand",              bench_ed25519_expand,              0, 1 },
+    { "ed25519_decompress",          bench_ed25519_decompress,          0, 1 },
+    { "ed25519_verify",              bench_ed25519_verify,              0, 1 },
+    { "ed25519_verify/64k",          bench_ed25519_verify_long,         0, 1 },
+    { "ed25519_verify_decompressed", bench_ed25519_verify_decompressed, 0, 1 },
+    { "ed25519_verify_batch/64",     bench_ed25519_verify_batch,        0, 1 },
+    { "ed25519ph_sign",              bench_ed25519ph_sign,              0, 1 },
+    { "ed25519ph_verify",            bench_ed25519ph_verify,            0, 1 },
+};
+
+
+/* Fill the inputs. Signatures are made over distinct 64-byte messages with a
+ * single key, and X25519 gets valid public keys, so that the batch and
+ * precomputation functions see realistic work. The hash table and the Bloom
+ * filter are filled with distinct keys, and the latter also with the
+ * messages, which are then found again on every query. */
+static void setup(void) {
+    size_t i;
+
+    in = malloc(MAX_SIZE);
+    out = malloc(MAX_SIZE);
+    if (in == NULL || out == NULL) {
+        fprintf(stderr, "bench: out of memory\n");
+        exit(1);
+    }
+
+    for (i = 0; i < MAX_SIZE; i++)
+        in[i] = out[i] = (uint8_t) (i * 131 + 7);
+    for (i = 0; i < sizeof(key); i++)
+        key[i] = (uint8_t) (i + 1);
+    for (i = 0; i < sizeof(priv); i++)
+        priv[i] = (uint8_t) (i * 29 + 3);
+
+    nectar_ed25519_pubkey(pub, priv);
+    nectar_ed25519_expand(&sk, priv);
+    nectar_ed25519_decompress(&pk, pub);
+
+    for (i = 0; i < BATCH; i++) {
+        memset(msg[i], (int) i, 64);
+        msgs[i] = msg[i];
+        lens[i] = 64;
+        memcpy(pub + 32 * i, pub, 32);
+        nectar_ed25519_sign_expanded(sign + 64 * i, msg[i], 64, &sk);
+        nectar_curve25519_scalarmult_base(xpub + 32 * i, priv + 32 * i);
+    }
+
+    nectar_curve25519_precompute(&pre, xpub);
+
+    nectar_ed25519_sign_expanded(long_sign, in, LONG, &sk);
+    nectar_ed25519ph_sign(ph_sign, msg[0], 64, &sk);
+
+    for (i = 0; i < BATCH; i++) {
+        bufs0[i] = in + 64 * i;
+        bufs1[i] = out + 64 * i;
+    }
+
+    nectar_htable_init(&ht, key);
+    nectar_bloom_init(&bf, bloom_mem, sizeof(bloom_mem), 8, key);
+    for (i = 0; i < HTABLE; i++) {
+        memcpy(hkeys[i], &i, sizeof(i));
+        memset(hkeys[i] + sizeof(i), 0x5a, 16 - sizeof(i));
+        nectar_htable_put(&ht, hkeys[i], 16, hkeys[i]);
+        nectar_bloom_insert(&bf, hkeys[i], 16);
+    }
+    nectar_bloom_insert_batch(&bf, msgs, lens, BATCH);
+}
+
+
+/* Clocks. */
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static double cycles(void) {
+#if defined(HAVE_RDTSC)
+    return (double) __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+
+static int compare(const void * a, const void * b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+static double median(const double * v, int n) {
+    double s[MAX_SAMPLES];
+
+    memcpy(s, v, n * sizeof(double));
+    qsort(s, n, sizeof(double), compare);
+
+    return (n & 1) ? s[n / 2] : (s[n / 2 - 1] + s[n / 2]) / 2;
+}
+
+
+/* Take `n` samples of one benchmark, in nanoseconds and cycles per call. */
+static void measure(const struct bench * b, size_t size, double * ns, double * cyc, int n) {
+    unsigned long reps = 1, r;
+    double t, c;
+    int i;
+
+    /* Warm up, and double the number of calls per sample until it takes long
+     * enough to be timed accurately. */
+    for (;;) {
+        t = now();
+        for (r = 0; r < reps; r++)
+            b->fn(size);
+        t = now() - t;
+
+        if (t >= SAMPLE_NS / 2)
+            break;
+        reps *= 2;
+    }
+
+    for (i = 0; i < n; i++) {
+        t = now();
+        c = cycles();
+        for (r = 0; r < reps; r++)
+            b->fn(size);
+        c = cycles() - c;
+        t = now() - t;
+
+        ns[i] = t / (double) reps;
+        cyc[i] = c / (double) reps;
+    }
+}
+
+
+static void print_samples(FILE * f, const char * key, const double * v, int n) {
+    int i;
+
+    fprintf(f, "\"%s\": [", key);
+    for (i = 0; i < n; i++)
+        fprintf(f, "%s%.2f", i ? ", " : "", v[i]);
+    fprintf(f, "]");
+}
+
+/* Run one benchmark at one size, and report it. */
+static void run(FILE * f, int * first, const struct bench * b, size_t size,
+                const char * backend, int n) {
+    double ns[MAX_SAMPLES], cyc[MAX_SAMPLES];
+    double mns, mcyc;
+
+    measure(b, size, ns, cyc, n);
+    mns = median(ns, n);
+    mcyc = median(cyc, n);
+
+    if (size > 0)
+        fprintf(stderr, "%-30s %-9s %9lu B %12.1f ns %8.3f ns/B %8.3f cyc/B\n",
+                b->name, backend, (unsigned long) size, mns,
+                mns / (double) size, mcyc / (double) size);
+    else
+        fprintf(stderr, "%-30s %-9s %11s %12.1f ns %14.0f cyc/op\n",
+                b->name, backend, "", mns, mcyc);
+
+    fprintf(f, "%s    {\"name\": \"%s\", \"size\": %lu, \"backend\": \"%s\", "
+            "\"median_ns\": %.2f, \"median_cycles\": %.2f, ",
+            *first ? "" : ",\n", b->name, (unsigned long) size, backend, mns, mcyc);
+    print_samples(f, "ns", ns, n);
+    fprintf(f, ", ");
+    print_samples(f, "cycles", cyc, n);
+    fprintf(f, "}");
+
+    *first = 0;
+}
+
+
+/* Check whether a benchmark was selected on the command line. */
+static int selected(const char * name, char ** names, int count) {
+    int i;
+
+    if (count == 0)
+        return 1;
+    for (i = 0; i < count; i++) {
+        if (strncmp(name, names[i], strlen(names[i])) == 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+
+int main(int argc, char ** argv) {
+    const char * path = NULL;
+    FILE * f = stdout;
+    uint32_t features;
+    int n = SAMPLES;
+    int first = 1;
+    size_t i, j, size;
+
+    while (argc > 1 && argv[1][0] == '-') {
+        if (strcmp(argv[1], "-n") == 0 && argc > 2) {
+            n = atoi(argv[2]);
+        } else if (strcmp(argv[1], "-o") == 0 && argc > 2) {
+            path = argv[2];
+        } else {
+            fprintf(stderr, "usage: %s [-n samples] [-o file.json] [name...]\n", argv[0]);
+            return 1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (n < 1 || n > MAX_SAMPLES) {
+        fprintf(stderr, "%s: samples must be between 1 and %d\n", argv[0], MAX_SAMPLES);
+        return 1;
+    }
+
+    if (path != NULL && (f = fopen(path, "w")) == NULL) {
+        fprintf(stderr, "%s: cannot open %s\n", argv[0], path);
+        return 1;
+    }
+
+    setup();
+    features = nectar_cpu_features();
+
+    fprintf(f, "{\n  \"version\": 1,\n  \"features\": %lu,\n  \"samples\": %d,\n"
+            "  \"results\": [\n", (unsigned long) features, n);
+
+    for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if (!selected(benches[i].name, argv + 1, argc - 1))
+            continue;
+
+        for (j = 0; j < sizeof(backends) / sizeof(backends[0]); j++) {
+            /* Without dispatch, or without any features, there is only one
+             * implementation to run. */
+            if (j > 0 && (!benches[i].dispatch || features == 0))
+                break;
+
+            nectar_cpu_mask(backends[j].mask);
+
+            if (benches[i].sized) {
+                for (size = MIN_SIZE; size <= MAX_SIZE; size *= 4)
+                    run(f, &first, &benches[i], size, backends[j].name, n);
+            } else {
+                run(f, &first, &benches[i], 0, backends[j].name, n);
+            }
+        }
+
+        nectar_cpu_mask(~(uint32_t) 0);
+    }
+
+    fprintf(f, "\n  ]\n}\n");
+
+    if (f != stdout && fclose(f) != 0) {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], path);
+        return 1;
+    }
+
+    return 0;
+}
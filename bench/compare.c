@@ -0,0 +1,350 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Compare two sets of benchmark results written by bench.
+ *
+ * Usage: compare [-t percent] [-a alpha] baseline.json current.json
+ *
+ * Every benchmark, size and backend present in both files is compared with a
+ * two-sided Mann-Whitney U test on the per-call times. It counts as a
+ * regression if the median time went up by more than `percent` (5 by default)
+ * and the difference is significant at level `alpha` (0.01 by default).
+ * Results found in only one of the files are listed as well.
+ *
+ * The exit status is 1 if there was any regression, and 2 on errors,
+ * including when no result could be compared at all. */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Maximum number of samples per result, as in bench. */
+#define MAX_SAMPLES  1001
+
+struct result {
+    char name[64];
+    char backend[16];
+    unsigned long size;
+    double ns[MAX_SAMPLES];
+    int n;
+};
+
+struct results {
+    struct result * r;
+    size_t len;
+};
+
+
+/* Read a whole file into a null-terminated buffer. */
+static char * slurp(const char * path) {
+    FILE * f;
+    char * buf = NULL, * p;
+    size_t len = 0, cap = 0, num;
+
+    if ((f = fopen(path, "r")) == NULL)
+        return NULL;
+
+    do {
+        if (cap - len < 4096) {
+            cap = 2 * cap + 4096;
+            if ((p = realloc(buf, cap + 1)) == NULL) {
+                free(buf);
+                fclose(f);
+                return NULL;
+            }
+            buf = p;
+        }
+        num = fread(buf + len, 1, cap - len, f);
+        len += num;
+    } while (num > 0);
+
+    fclose(f);
+    buf[len] = '\0';
+
+    return buf;
+}
+
+
+/* Copy the string value of `"key": "..."` in a line into dst. */
+static int string(char * dst, size_t cap, const char * line, const char * key) {
+    const char * p = strstr(line, key);
+    size_t len;
+
+    if (p == NULL)
+        return -1;
+    p += strlen(key);
+
+    len = strcspn(p, "\"");
+    if (p[len] != '"' || len >= cap)
+        return -1;
+
+    memcpy(dst, p, len);
+    dst[len] = '\0';
+
+    return 0;
+}
+
+
+/* Parse one line of results, as written by bench. Lines that hold no result
+ * are skipped. */
+static int parse_line(struct result * r, const char * line) {
+    const char * p;
+    char * end;
+
+    if (string(r->name, sizeof(r->name), line, "\"name\": \"") != 0 ||
+        string(r->backend, sizeof(r->backend), line, "\"backend\": \"") != 0 ||
+        (p = strstr(line, "\"size\": ")) == NULL)
+        return -1;
+    r->size = strtoul(p + 8, NULL, 10);
+
+    if ((p = strstr(line, "\"ns\": [")) == NULL)
+        return -1;
+    p += 7;
+
+    for (r->n = 0; *p != ']'; r->n++) {
+        if (r->n == MAX_SAMPLES)
+            return -1;
+        r->ns[r->n] = strtod(p, &end);
+        if (end == p)
+            return -1;
+        p = end + strspn(end, ", ");
+    }
+
+    return r->n > 0 ? 0 : -1;
+}
+
+
+static int load(struct results * res, const char * path) {
+    struct result * p;
+    char * buf, * line, * next;
+    size_t cap = 0;
+
+    if ((buf = slurp(path)) == NULL) {
+        fprintf(stderr, "compare: cannot read %s\n", path);
+        return -1;
+    }
+
+    res->r = NULL;
+    res->len = 0;
+
+    for (line = buf; line != NULL; line = next) {
+        if ((next = strchr(line, '\n')) != NULL)
+            *next++ = '\0';
+        if (strstr(line, "\"name\"") == NULL)
+            continue;
+
+        if (res->len == cap) {
+            cap = 2 * cap + 64;
+            if ((p = realloc(res->r, cap * sizeof(*p))) == NULL) {
+                fprintf(stderr, "compare: out of memory\n");
+                free(buf);
+                return -1;
+            }
+            res->r = p;
+        }
+
+        if (parse_line(&res->r[res->len], line) != 0) {
+            fprintf(stderr, "compare: malformed result in %s\n", path);
+            free(buf);
+            return -1;
+        }
+        res->len++;
+    }
+
+    free(buf);
+
+    if (res->len == 0) {
+        fprintf(stderr, "compare: no results in %s\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int compare(const void * a, const void * b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+static double median(const double * v, int n) {
+    double s[MAX_SAMPLES];
+
+    memcpy(s, v, n * sizeof(double));
+    qsort(s, n, sizeof(double), compare);
+
+    return (n & 1) ? s[n / 2] : (s[n / 2 - 1] + s[n / 2]) / 2;
+}
+
+
+/* Two-sided p-value of the Mann-Whitney U test, using the normal
+ * approximation with continuity and tie corrections. */
+static double mann_whitney(const double * x, int nx, const double * y, int ny) {
+    double v[2 * MAX_SAMPLES];
+    int from[2 * MAX_SAMPLES];
+    double rank, ties = 0, u, mu, sigma, z;
+    int n = nx + ny;
+    int i, j, k;
+
+    /* Sort the pooled samples with an insertion sort, remembering which came
+     * from x. */
+    for (i = 0; i < n; i++) {
+        double t = i < nx ? x[i] : y[i - nx];
+        int f = i < nx;
+
+        for (j = i; j > 0 && v[j - 1] > t; j--) {
+            v[j] = v[j - 1];
+            from[j] = from[j - 1];
+        }
+        v[j] = t;
+        from[j] = f;
+    }
+
+    /* Sum the ranks of x, giving tied values their average rank. */
+    rank = 0;
+    for (i = 0; i < n; i = j) {
+        for (j = i + 1; j < n && v[j] == v[i]; j++)
+            ;
+        for (k = i; k < j; k++) {
+            if (from[k])
+                rank += (i + j + 1) / 2.0;
+        }
+        ties += (double) (j - i) * (j - i) * (j - i) - (j - i);
+    }
+
+    u = rank - nx * (nx + 1) / 2.0;
+    mu = nx * (double) ny / 2;
+    sigma = sqrt(nx * (double) ny / 12 * ((n + 1) - ties / ((double) n * (n - 1))));
+    if (sigma == 0)
+        return 1;
+
+    z = (fabs(u - mu) - 0.5) / sigma;
+    if (z < 0)
+        z = 0;
+
+    return erfc(z / sqrt(2));
+}
+
+
+/* Find the result with the same name, size and backend as `r`. */
+static struct result * find(const struct results * res, const struct result * r) {
+    size_t i;
+
+    for (i = 0; i < res->len; i++) {
+        if (strcmp(r->name, res->r[i].name) == 0 && r->size == res->r[i].size &&
+            strcmp(r->backend, res->r[i].backend) == 0)
+            return &res->r[i];
+    }
+
+    return NULL;
+}
+
+
+/* List the results of `a` which are missing from `b`. */
+static int missing(const struct results * a, const struct results * b, const char * what) {
+    size_t i;
+    int num = 0;
+
+    for (i = 0; i < a->len; i++) {
+        if (find(b, &a->r[i]) != NULL)
+            continue;
+        if (num++ == 0)
+            printf("\n%s:\n", what);
+        printf("%-30s %-9s %9lu\n", a->r[i].name, a->r[i].backend, a->r[i].size);
+    }
+
+    return num;
+}
+
+
+int main(int argc, char ** argv) {
+    struct results base, cur;
+    struct result * b, * c;
+    double threshold = 5, alpha = 0.01;
+    double mb, mc, change, p;
+    const char * verdict;
+    int regressions = 0, compared = 0, only_base, only_cur;
+    size_t i;
+
+    while (argc > 1 && argv[1][0] == '-') {
+        if (strcmp(argv[1], "-t") == 0 && argc > 2) {
+            threshold = atof(argv[2]);
+        } else if (strcmp(argv[1], "-a") == 0 && argc > 2) {
+            alpha = atof(argv[2]);
+        } else {
+            argc = 0;
+            break;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: compare [-t percent] [-a alpha] baseline.json current.json\n");
+        return 2;
+    }
+
+    if (load(&base, argv[1]) != 0 || load(&cur, argv[2]) != 0)
+        return 2;
+
+    printf("%-30s %-9s %9s %14s %14s %8s %9s\n",
+           "name", "backend", "size", "baseline ns", "current ns", "change", "p");
+
+    for (i = 0; i < base.len; i++) {
+        b = &base.r[i];
+        if ((c = find(&cur, b)) == NULL)
+            continue;
+
+        mb = median(b->ns, b->n);
+        mc = median(c->ns, c->n);
+        change = 100 * (mc - mb) / mb;
+        p = mann_whitney(b->ns, b->n, c->ns, c->n);
+
+        if (p >= alpha || fabs(change) <= threshold) {
+            verdict = "";
+        } else if (change > 0) {
+            verdict = "REGRESSION";
+            regressions++;
+        } else {
+            verdict = "faster";
+        }
+
+        printf("%-30s %-9s %9lu %14.1f %14.1f %+7.1f%% %9.2g%s%s\n",
+               b->name, b->backend, b->size, mb, mc, change, p,
+               *verdict ? "  " : "", verdict);
+        compared++;
+    }
+
+    only_base = missing(&base, &cur, "Only in the baseline");
+    only_cur = missing(&cur, &base, "Only in the current results");
+
+    printf("\n%d compared, %d regressions beyond %.1f%% at p < %g, "
+           "%d only in the baseline, %d only in the current results\n",
+           compared, regressions, threshold, alpha, only_base, only_cur);
+
+    free(base.r);
+    free(cur.r);
+
+    if (compared == 0) {
+        fprintf(stderr, "compare: no results in common\n");
+        return 2;
+    }
+
+    return regressions > 0 ? 1 : 0;
+}
@@ -114,10 +114,38 @@ void nectar_poly1305_final(struct nectar_poly1305_ctx * cx, uint8_t * mac, size_
  * with the help of the `nectar_curve25519_clamp` function, and a corresponding
  * public key can be created using `nectar_curve25519_scalarmult_base`. The
  * `nectar_curve25519_scalarmult` function, given one party's private key and
- * the other's public key, calculates the shared secret. */
+ * the other's public key, calculates the shared secret.
+ *
+ * `nectar_curve25519_scalarmult_batch` computes `n` shared secrets at once,
+ * each from consecutive 32-byte keys in `priv` and `other_pub`, and stores them
+ * consecutively in `shared`. The results are identical to those of
+ * `nectar_curve25519_scalarmult`, but the batch shares the cost of the final
+ * inversion. Separate parts of a batch can be computed on separate threads.
+ *
+ * When many shared secrets are computed against the same public key,
+ * `nectar_curve25519_precompute` can build a table of multiples of that key
+ * once, after which `nectar_curve25519_scalarmult_precomp` gives the same
+ * results as `nectar_curve25519_scalarmult` in a fraction of the time. The
+ * table is about 30 KiB, and is only read once built, so it can be shared
+ * between threads. Its contents are internal to the library; the member
+ * holding the limbs depends on the field arithmetic it was built with. */
+struct nectar_curve25519_precomp {
+    uint8_t pub[32];
+    int fallback;
+    union {
+        uint64_t fe51[3840];
+        int32_t fe32[7680];
+    } table;
+};
+
 void nectar_curve25519_clamp(uint8_t priv[32]);
 void nectar_curve25519_scalarmult_base(uint8_t pub[32], const uint8_t priv[32]);
 void nectar_curve25519_scalarmult(uint8_t shared[32], const uint8_t priv[32], const uint8_t other_pub[32]);
+void nectar_curve25519_scalarmult_batch(uint8_t * shared, const uint8_t * priv,
+                                        const uint8_t * other_pub, size_t n);
+void nectar_curve25519_precompute(struct nectar_curve25519_precomp * pre, const uint8_t other_pub[32]);
+void nectar_curve25519_scalarmult_precomp(uint8_t shared[32], const uint8_t priv[32],
+                                          const struct nectar_curve25519_precomp * pre);
 
 
 /* Implementation of the Ed25519 digital signature scheme as defined in
@@ -128,12 +156,96 @@ void nectar_curve25519_scalarmult(uint8_t shared[32], const uint8_t priv[32], co
  * from any sequence of 32 bytes. This public key, together with the private
  * key, can then be used to generate a 64-byte signature for any chunk of data
  * using `nectar_ed25519_sign`. Signatures can be verified in constant time
- * with the `nectar_ed25519_verify` function. */
+ * with the `nectar_ed25519_verify` function.
+ *
+ * `nectar_ed25519_pubkey_batch` generates `n` public keys at once, from
+ * consecutive 32-byte private keys in `priv`, and stores them consecutively in
+ * `pub`. The results are identical to those of `nectar_ed25519_pubkey`, but
+ * the batch shares the cost of the final inversion.
+ *
+ * Signing with `nectar_ed25519_sign` hashes the private key every time. When
+ * many messages are signed with the same key, `nectar_ed25519_expand` can do
+ * that once, storing the result together with the matching public key, and
+ * `nectar_ed25519_sign_expanded` then produces the same signatures as
+ * `nectar_ed25519_sign`. The expanded key must be kept as secret as the
+ * private key itself.
+ *
+ * Likewise, `nectar_ed25519_decompress` decodes a public key and precomputes
+ * the multiples of it needed during verification, failing if the key is not a
+ * valid point. `nectar_ed25519_verify_decompressed` then checks signatures
+ * made with that key, with the same results as `nectar_ed25519_verify`. Like
+ * the X25519 precomputed table, the table in the decompressed key is internal
+ * to the library.
+ *
+ * `nectar_ed25519_verify_batch` verifies `n` signatures at once, each from
+ * consecutive 64-byte signatures in `sign` and 32-byte keys in `pub`, and
+ * stores the result for each in `out`. It returns 0 if all signatures were
+ * valid, and -1 otherwise. Signatures are checked together in groups of up to
+ * 64, which is about twice as fast as checking them one by one; a group that
+ * fails is verified again with `nectar_ed25519_verify`.
+ *
+ * The two checks differ for maliciously crafted signatures. The group check
+ * is cofactored (it verifies 8SB = 8R + 8hA), while `nectar_ed25519_verify`
+ * and `nectar_ed25519_verify_decompressed` are cofactorless (SB = R + hA, and
+ * the encoding of R must match exactly). A signature whose R or public key
+ * has a small-order component can therefore pass in a batch while failing on
+ * its own; callers that need both to agree must not use the batch function
+ * for untrusted keys. Honestly generated signatures pass both. */
+struct nectar_ed25519_sk {
+    uint8_t scalar[32];
+    uint8_t prefix[32];
+    uint8_t pub[32];
+};
+
+struct nectar_ed25519_pk {
+    uint8_t pub[32];
+    union {
+        uint64_t fe51[160];
+        int32_t fe32[320];
+    } table;
+};
+
 void nectar_ed25519_pubkey(uint8_t pub[32], const uint8_t priv[32]);
+void nectar_ed25519_pubkey_batch(uint8_t * pub, const uint8_t * priv, size_t n);
 void nectar_ed25519_sign(uint8_t sign[64], const uint8_t * data, size_t len, const uint8_t pub[32], const uint8_t priv[32]);
+void nectar_ed25519_expand(struct nectar_ed25519_sk * sk, const uint8_t priv[32]);
+void nectar_ed25519_sign_expanded(uint8_t sign[64], const uint8_t * data, size_t len,
+                                  const struct nectar_ed25519_sk * sk);
+int nectar_ed25519_decompress(struct nectar_ed25519_pk * pk, const uint8_t pub[32]);
+int nectar_ed25519_verify_decompressed(const uint8_t sign[64], const uint8_t * data, size_t len,
+                                       const struct nectar_ed25519_pk * pk);
+int nectar_ed25519_verify_batch(int * out, const uint8_t * sign, const uint8_t * const * data,
+                                const size_t * lens, const uint8_t * pub, size_t n);
 int nectar_ed25519_verify(const uint8_t sign[64], const uint8_t * data, size_t len, const uint8_t pub[32]);
 
 
+/* Implementation of Ed25519ph, the prehashed variant of Ed25519 defined in
+ * RFC 8032, with an empty context. The message is hashed with SHA-512 before
+ * it is signed, so unlike with plain Ed25519 it can be passed in pieces, and
+ * only needs to be read once.
+ *
+ * A message is hashed by calling `nectar_ed25519ph_init`, followed by any
+ * number of calls to `nectar_ed25519ph_update`. The hash is then signed with
+ * `nectar_ed25519ph_sign_final`, or checked against a signature with
+ * `nectar_ed25519ph_verify_final`. `nectar_ed25519ph_sign` and
+ * `nectar_ed25519ph_verify` do the same for a message in one piece. Ed25519ph
+ * signatures are not interchangeable with plain Ed25519 signatures. */
+struct nectar_ed25519ph_ctx {
+    struct nectar_sha512_ctx h;
+};
+
+void nectar_ed25519ph_init(struct nectar_ed25519ph_ctx * cx);
+void nectar_ed25519ph_update(struct nectar_ed25519ph_ctx * cx, const uint8_t * data, size_t len);
+void nectar_ed25519ph_sign_final(struct nectar_ed25519ph_ctx * cx, uint8_t sign[64],
+                                 const struct nectar_ed25519_sk * sk);
+int nectar_ed25519ph_verify_final(struct nectar_ed25519ph_ctx * cx, const uint8_t sign[64],
+                                  const uint8_t pub[32]);
+void nectar_ed25519ph_sign(uint8_t sign[64], const uint8_t * data, size_t len,
+                           const struct nectar_ed25519_sk * sk);
+int nectar_ed25519ph_verify(const uint8_t sign[64], const uint8_t * data, size_t len,
+                            const uint8_t pub[32]);
+
+
 /* Implementation of the PBKDF2 key derivation function as defined in RFC 2898
  * and PKCS #5 v2.0, using SHA-512 rather than MD2, MD5 or SHA-1. */
 void nectar_pbkdf2_sha512(uint8_t * key, size_t key_len,
@@ -143,14 +255,192 @@ void nectar_pbkdf2_sha512(uint8_t * key, size_t key_len,
 
 
 /* Implementation of the SipHash-2-4 hash function as defined in "SipHash: a
- * fast short-input PRF" (Aumasson, Bernstein; 2012). */
+ * fast short-input PRF" (Aumasson, Bernstein; 2012).
+ *
+ * When hashing many inputs with the same seed, `nectar_siphash_expand` can be
+ * used to compute the initial hash state once, which is then passed to
+ * `nectar_siphash_expanded` instead of the seed.
+ *
+ * `nectar_siphash_batch` hashes `n` inputs with the same seed, storing the
+ * digest of `data[i]` (which is `lens[i]` bytes long) in `out[i]`. The results
+ * are identical to those of `nectar_siphash`, but hashing several inputs in
+ * lockstep makes bulk work (such as rehashing a table) a lot faster.
+ * `nectar_siphash_batch_expanded` does the same with an expanded key. */
+struct nectar_siphash_key {
+    uint64_t v[4];
+};
+
 uint64_t nectar_siphash(const uint8_t seed[16], const uint8_t * data, size_t len);
+void nectar_siphash_expand(struct nectar_siphash_key * key, const uint8_t seed[16]);
+uint64_t nectar_siphash_expanded(const struct nectar_siphash_key * key,
+                                 const uint8_t * data, size_t len);
+void nectar_siphash_batch(const uint8_t seed[16], const uint8_t * const * data,
+                          const size_t * lens, uint64_t * out, size_t n);
+void nectar_siphash_batch_expanded(const struct nectar_siphash_key * key,
+                                   const uint8_t * const * data,
+                                   const size_t * lens, uint64_t * out, size_t n);
+
+
+/* A hash table mapping byte strings to arbitrary pointers. Keys are hashed
+ * with SipHash-2-4 under a secret seed, so that an attacker who chooses the
+ * keys can't force them into long collision chains.
+ *
+ * Slots are organized in groups of 16, each with 16 control bytes holding 7
+ * bits of the hash of the key stored in the corresponding slot. A lookup scans
+ * all control bytes in a group at once, and only compares keys whose bits
+ * match. Keys of up to 16 bytes are stored inline; longer keys are copied.
+ * When the table has to grow, entries are moved to the new table a couple of
+ * groups at a time by subsequent insertions and removals, rather than all at
+ * once.
+ *
+ * `nectar_htable_put` returns -1 if it runs out of memory, leaving the table
+ * unchanged. `nectar_htable_get` and `nectar_htable_del` return -1 if the key
+ * is not in the table, and otherwise store the associated value in `*value`
+ * (unless `value` is NULL). A table must be released with `nectar_htable_free`,
+ * after which it is empty and may be used again. */
+struct nectar_htable {
+    struct nectar_siphash_key key;
+    uint8_t * ctrl;
+    void * slots;
+    size_t cap;
+    size_t left;
+    uint8_t * old_ctrl;
+    void * old_slots;
+    size_t old_cap;
+    size_t cursor;
+    size_t len;
+};
+
+void nectar_htable_init(struct nectar_htable * ht, const uint8_t seed[16]);
+void nectar_htable_free(struct nectar_htable * ht);
+int nectar_htable_get(const struct nectar_htable * ht, const uint8_t * key, size_t len, void ** value);
+int nectar_htable_put(struct nectar_htable * ht, const uint8_t * key, size_t len, void * value);
+int nectar_htable_del(struct nectar_htable * ht, const uint8_t * key, size_t len, void ** value);
+size_t nectar_htable_len(const struct nectar_htable * ht);
+
+
+/* A blocked Bloom filter keyed with SipHash-2-4, so that an attacker who
+ * doesn't know the seed can't pick inputs that saturate it.
+ *
+ * The filter is split into 64-byte blocks. Each input is hashed once; the
+ * upper half of the hash selects a block, and all `k` bits are picked from
+ * within that block by double hashing on disjoint bits of the lower half, so
+ * a query touches a single cache line.
+ *
+ * A filter lives entirely in caller-supplied memory: a 64-byte header followed
+ * by the blocks, with no pointers and a fixed byte order, so it can be written
+ * to disk and later mapped back into memory. `nectar_bloom_size` returns the
+ * number of bytes needed for a given number of blocks (or 0 if that number is
+ * unsupported). `nectar_bloom_init` formats a chunk of memory as an empty
+ * filter with `k` bits per element (at most 32), and `nectar_bloom_load`
+ * attaches to an existing one. Both return -1 if the memory can't be used,
+ * which for `nectar_bloom_load` includes the seed being different from the
+ * one the filter was created with.
+ *
+ * `nectar_bloom_query` returns 0 if the input may have been inserted, and -1
+ * if it definitely hasn't. The batch functions process `n` inputs at a time,
+ * overlapping the memory accesses of consecutive inputs. */
+struct nectar_bloom {
+    struct nectar_siphash_key key;
+    uint8_t * bits;
+    uint64_t nblocks;
+    unsigned int k;
+};
+
+size_t nectar_bloom_size(uint64_t nblocks);
+int nectar_bloom_init(struct nectar_bloom * bf, void * mem, size_t len, unsigned int k, const uint8_t seed[16]);
+int nectar_bloom_load(struct nectar_bloom * bf, void * mem, size_t len, const uint8_t seed[16]);
+void nectar_bloom_insert(struct nectar_bloom * bf, const uint8_t * data, size_t len);
+int nectar_bloom_query(const struct nectar_bloom * bf, const uint8_t * data, size_t len);
+void nectar_bloom_insert_batch(struct nectar_bloom * bf, const uint8_t * const * data,
+                               const size_t * lens, size_t n);
+void nectar_bloom_query_batch(const struct nectar_bloom * bf, const uint8_t * const * data,
+                              const size_t * lens, int * out, size_t n);
 
 
 /* Utility function which compares two equally sized chunks of memory without
  * leaking any information via timing side channels. Returns 0 if and only if
- * the two chunks are identical. */
+ * the two chunks are identical.
+ *
+ * `nectar_bcmp_batch` compares `n` pairs of `len`-byte chunks, `bufs0[i]` with
+ * `bufs1[i]`, and returns a mask in which bit `i` is set if and only if the
+ * `i`th pair differs. At most 64 pairs can be compared per call; if `n` is
+ * larger, nothing is compared and every bit of the result is set. */
 int nectar_bcmp(const uint8_t * buf0, const uint8_t * buf1, size_t len);
+uint64_t nectar_bcmp_batch(const uint8_t * const * bufs0, const uint8_t * const * bufs1,
+                           size_t len, size_t n);
+
+
+/* Runtime CPU feature detection. Where a function has several implementations,
+ * the library picks the fastest one the CPU supports. Currently that is only
+ * the SipHash batch function, the base point table lookup, and the X25519
+ * ladder when built with 26/25-bit limbs, all of which can use AVX2. ChaCha20,
+ * Poly1305, SHA-512 and the field arithmetic only have portable code (the
+ * field backend is picked at compile time), so the other features are
+ * reported but not yet used.
+ *
+ * `nectar_cpu_features` returns the set of features in use. It is detected
+ * with cpuid on first use, and restricted to the names listed in the
+ * NECTAR_CPU environment variable if it is set (e.g. "sse2,ssse3", or "none"
+ * for the portable code everywhere). `nectar_cpu_mask` restricts it further,
+ * which is mainly useful for testing; it must not be called while other
+ * threads use the library. Features the CPU lacks can never be enabled. */
+#define NECTAR_CPU_SSE2   0x01
+#define NECTAR_CPU_SSSE3  0x02
+#define NECTAR_CPU_AVX2   0x04
+#define NECTAR_CPU_BMI2   0x08
+#define NECTAR_CPU_ADX    0x10
+
+uint32_t nectar_cpu_features(void);
+void nectar_cpu_mask(uint32_t mask);
+
+
+/* Usage counters, for finding out where the time goes in production. They are
+ * only kept if the library is built with NECTAR_STATS defined (for example
+ * `make FLAGS=-DNECTAR_STATS`), which needs GCC or Clang and POSIX threads.
+ * Otherwise no counting code is compiled in, and `nectar_stats_snapshot` only
+ * zeroes `st` and returns -1.
+ *
+ * Each thread counts into its own cache-line-aligned block, without locks.
+ * `nectar_stats_snapshot` adds up the blocks of all threads, past and
+ * present, so the counts cover the whole life of the process.
+ *
+ * For each primitive, `calls` counts the calls that take data, `bytes` the
+ * data passed to them, and `sizes[i]` the calls with 2^(i-1) <= len < 2^i,
+ * with `sizes[0]` for empty inputs. The streaming functions count each update.
+ * Calls made within the library count too, so that HMAC, PBKDF2 and Ed25519
+ * also show up under SHA-512. Each Curve25519 scalar multiplication counts as
+ * one call on 32 bytes, and field multiplications include squarings. */
+#define NECTAR_STATS_SHA512          0
+#define NECTAR_STATS_HMAC_SHA512     1
+#define NECTAR_STATS_PBKDF2          2
+#define NECTAR_STATS_CHACHA20        3
+#define NECTAR_STATS_POLY1305        4
+#define NECTAR_STATS_SIPHASH         5
+#define NECTAR_STATS_BCMP            6
+#define NECTAR_STATS_CURVE25519      7
+#define NECTAR_STATS_ED25519_SIGN    8
+#define NECTAR_STATS_ED25519_VERIFY  9
+#define NECTAR_STATS_PRIMITIVES      10
+
+struct nectar_stats_primitive {
+    uint64_t calls;
+    uint64_t bytes;
+    uint64_t sizes[65];
+};
+
+struct nectar_stats {
+    struct nectar_stats_primitive primitive[NECTAR_STATS_PRIMITIVES];
+    uint64_t sha512_blocks;
+    uint64_t chacha20_blocks;
+    uint64_t poly1305_blocks;
+    uint64_t field_mul;
+    uint64_t field_invert;
+    uint64_t verify_ok;
+    uint64_t verify_fail;
+};
+
+int nectar_stats_snapshot(struct nectar_stats * st);
 
 
 #endif
@@ -1,4 +1,11 @@
 #include "src/25519/fe.h"
+#include "src/stats.h"
+
+/* The functions in this file which depend on the representation of field
+ * elements are only used by the 26/25-bit backend. The rest are shared with
+ * the 51-bit backend in fe51.c. */
+
+#if !defined(NECTAR_25519_FE51)
 
 void fe_0(fe h)
 {
@@ -282,6 +289,10 @@ void fe_frombytes(fe h,const uint8_t *s)
   h[9] = h9;
 }
 
+#endif
+
+#if !defined(NECTAR_25519_SAFEGCD)
+
 void fe_invert(fe out,const fe z)
 {
   fe t0;
@@ -290,6 +301,8 @@ void fe_invert(fe out,const fe z)
   fe t3;
   int i;
 
+  stats_count(field_invert,1);
+
   fe_sq(t0,z); for (i = 1;i < 1;++i) fe_sq(t0,t0);
   fe_sq(t1,t0); for (i = 1;i < 2;++i) fe_sq(t1,t1);
   fe_mul(t1,z,t1);
@@ -316,6 +329,13 @@ void fe_invert(fe out,const fe z)
   return;
 }
 
+void fe_invert_vartime(fe out,const fe z)
+{
+  fe_invert(out,z);
+}
+
+#endif
+
 int fe_isnegative(const fe f)
 {
   uint8_t s[32];
@@ -332,6 +352,8 @@ int fe_isnonzero(const fe f)
   return nectar_bcmp(s, zero, 32);
 }
 
+#if !defined(NECTAR_25519_FE51)
+
 void fe_mul(fe h,const fe f,const fe g)
 {
   int32_t f0 = f[0];
@@ -489,6 +511,8 @@ void fe_mul(fe h,const fe f,const fe g)
   int64_t carry8;
   int64_t carry9;
 
+  stats_count(field_mul,1);
+
   carry0 = (h0 + (int64_t) (1<<25)) >> 26; h1 += carry0; h0 -= carry0 << 26;
   carry4 = (h4 + (int64_t) (1<<25)) >> 26; h5 += carry4; h4 -= carry4 << 26;
 
@@ -611,6 +635,8 @@ void fe_neg(fe h,const fe f)
   h[9] = h9;
 }
 
+#endif
+
 void fe_pow22523(fe out,const fe z)
 {
   fe t0;
@@ -644,6 +670,8 @@ void fe_pow22523(fe out,const fe z)
   return;
 }
 
+#if !defined(NECTAR_25519_FE51)
+
 void fe_sq(fe h,const fe f)
 {
   int32_t f0 = f[0];
@@ -745,6 +773,8 @@ void fe_sq(fe h,const fe f)
   int64_t carry8;
   int64_t carry9;
 
+  stats_count(field_mul,1);
+
   carry0 = (h0 + (int64_t) (1<<25)) >> 26; h1 += carry0; h0 -= carry0 << 26;
   carry4 = (h4 + (int64_t) (1<<25)) >> 26; h5 += carry4; h4 -= carry4 << 26;
 
@@ -877,6 +907,8 @@ void fe_sq2(fe h,const fe f)
   int64_t carry8;
   int64_t carry9;
 
+  stats_count(field_mul,1);
+
   h0 += h0;
   h1 += h1;
   h2 += h2;
@@ -1045,3 +1077,5 @@ void fe_tobytes(uint8_t *s,const fe h)
   s[30] = h9 >> 10;
   s[31] = h9 >> 18;
 }
+
+#endif
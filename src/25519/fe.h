@@ -3,30 +3,72 @@
 
 #include "include/nectar.h"
 
+/* Backend selection. Where the compiler has a 128-bit integer type, field
+ * elements are stored as five unsigned 51-bit limbs (see fe51.c); elsewhere
+ * they are stored as ten signed limbs of alternating 26 and 25 bits (see
+ * fe.c). Defining NECTAR_25519_FE32 forces the latter. */
+#if defined(__SIZEOF_INT128__) && !defined(NECTAR_25519_FE32)
+#define NECTAR_25519_FE51
+#endif
+
+/* Likewise, inversions use the safegcd algorithm where 128-bit integers are
+ * available (see safegcd.c), and Fermat's little theorem elsewhere. Defining
+ * NECTAR_25519_FERMAT forces the latter. */
+#if defined(__SIZEOF_INT128__) && !defined(NECTAR_25519_FERMAT)
+#define NECTAR_25519_SAFEGCD
+#endif
+
 /* Namespacing. */
-#define  fe             nectar__25519_fe_t
-
-#define  fe_0           nectar__25519_fe_0
-#define  fe_1           nectar__25519_fe_1
-#define  fe_add         nectar__25519_fe_add
-#define  fe_cmov        nectar__25519_fe_cmov
-#define  fe_copy        nectar__25519_fe_copy
-#define  fe_cswap       nectar__25519_fe_cswap
-#define  fe_frombytes   nectar__25519_fe_frombytes
-#define  fe_invert      nectar__25519_fe_invert
-#define  fe_isnegative  nectar__25519_fe_isnegative
-#define  fe_isnonzero   nectar__25519_fe_isnonzero
-#define  fe_mul         nectar__25519_fe_mul
-#define  fe_mul121666   nectar__25519_fe_mul121666
-#define  fe_neg         nectar__25519_fe_neg
-#define  fe_pow22523    nectar__25519_fe_pow22523
-#define  fe_sq          nectar__25519_fe_sq
-#define  fe_sq2         nectar__25519_fe_sq2
-#define  fe_sub         nectar__25519_fe_sub
-#define  fe_tobytes     nectar__25519_fe_tobytes
-
-/* Types. */
+#define  fe                 nectar__25519_fe_t
+
+#define  fe_0               nectar__25519_fe_0
+#define  fe_1               nectar__25519_fe_1
+#define  fe_add             nectar__25519_fe_add
+#define  fe_cmov            nectar__25519_fe_cmov
+#define  fe_copy            nectar__25519_fe_copy
+#define  fe_cswap           nectar__25519_fe_cswap
+#define  fe_frombytes       nectar__25519_fe_frombytes
+#define  fe_invert          nectar__25519_fe_invert
+#define  fe_invert_vartime  nectar__25519_fe_invert_vartime
+#define  fe_isnegative      nectar__25519_fe_isnegative
+#define  fe_isnonzero       nectar__25519_fe_isnonzero
+#define  fe_mul             nectar__25519_fe_mul
+#define  fe_mul121666       nectar__25519_fe_mul121666
+#define  fe_neg             nectar__25519_fe_neg
+#define  fe_pow22523        nectar__25519_fe_pow22523
+#define  fe_sq              nectar__25519_fe_sq
+#define  fe_sq2             nectar__25519_fe_sq2
+#define  fe_sub             nectar__25519_fe_sub
+#define  fe_tobytes         nectar__25519_fe_tobytes
+
+/* Types. The public structures that hold precomputed points have a union of
+ * limb arrays, of which FE_LIMBS names the one matching the backend, so that
+ * the points stored there are only ever accessed with their own limb type. */
+#if defined(NECTAR_25519_FE51)
+typedef uint64_t fe[5];
+#define FE_LIMBS  fe51
+#else
 typedef int32_t fe[10];
+#define FE_LIMBS  fe32
+#endif
+
+/* Constants are written as ten signed 26/25-bit limbs, and converted to the
+ * backend's representation at compile time. The 51-bit backend pairs them up
+ * and adds 2*p, which keeps every limb positive. */
+#if defined(NECTAR_25519_FE51)
+#define FE(a0, a1, a2, a3, a4, a5, a6, a7, a8, a9)                             \
+    { FE51_LIMB(a0, a1, 0xfffffffffffdaULL),                                   \
+      FE51_LIMB(a2, a3, 0xffffffffffffeULL),                                   \
+      FE51_LIMB(a4, a5, 0xffffffffffffeULL),                                   \
+      FE51_LIMB(a6, a7, 0xffffffffffffeULL),                                   \
+      FE51_LIMB(a8, a9, 0xffffffffffffeULL) }
+
+#define FE51_LIMB(lo, hi, bias)                                                \
+    ((uint64_t) ((int64_t) (lo) + (int64_t) (hi) * 67108864) + (bias))
+#else
+#define FE(a0, a1, a2, a3, a4, a5, a6, a7, a8, a9)                             \
+    { a0, a1, a2, a3, a4, a5, a6, a7, a8, a9 }
+#endif
 
 /* Functions. */
 void fe_0(fe h);
@@ -37,7 +79,7 @@ void fe_copy(fe h, const fe f);
 void fe_cswap(fe f, fe g, unsigned int b);
 void fe_frombytes(fe h, const uint8_t * s);
 void fe_invert(fe out, const fe z);
-void fe_invert(fe out, const fe z);
+void fe_invert_vartime(fe out, const fe z);
 int fe_isnegative(const fe f);
 int fe_isnonzero(const fe f);
 void fe_mul(fe h, const fe f, const fe g);
@@ -0,0 +1,349 @@
+#include "src/25519/fe.h"
+#include "src/stats.h"
+
+/* Field arithmetic on five unsigned limbs of 51 bits each. Outputs of fe_mul,
+ * fe_sq, fe_sub and friends have limbs below 2^51 plus a small carry; fe_add
+ * does not carry, so its outputs may be twice that. Every function accepts
+ * limbs of up to 2^53. */
+
+#if defined(NECTAR_25519_FE51)
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+#define MASK51 ((((uint64_t) 1) << 51) - 1)
+
+static uint64_t load_8(const uint8_t *in)
+{
+  uint64_t result;
+  result = (uint64_t) in[0];
+  result |= ((uint64_t) in[1]) << 8;
+  result |= ((uint64_t) in[2]) << 16;
+  result |= ((uint64_t) in[3]) << 24;
+  result |= ((uint64_t) in[4]) << 32;
+  result |= ((uint64_t) in[5]) << 40;
+  result |= ((uint64_t) in[6]) << 48;
+  result |= ((uint64_t) in[7]) << 56;
+  return result;
+}
+
+static void fe_carry(fe h,uint64_t h0,uint64_t h1,uint64_t h2,uint64_t h3,uint64_t h4)
+{
+  uint64_t carry;
+
+  carry = h0 >> 51; h1 += carry; h0 &= MASK51;
+  carry = h1 >> 51; h2 += carry; h1 &= MASK51;
+  carry = h2 >> 51; h3 += carry; h2 &= MASK51;
+  carry = h3 >> 51; h4 += carry; h3 &= MASK51;
+  carry = h4 >> 51; h0 += carry * 19; h4 &= MASK51;
+  carry = h0 >> 51; h1 += carry; h0 &= MASK51;
+
+  h[0] = h0;
+  h[1] = h1;
+  h[2] = h2;
+  h[3] = h3;
+  h[4] = h4;
+}
+
+static void fe_carry128(fe h,uint128_t h0,uint128_t h1,uint128_t h2,uint128_t h3,uint128_t h4)
+{
+  uint64_t r0, r1, r2, r3, r4;
+  uint64_t carry;
+
+  r0 = (uint64_t) h0 & MASK51; h1 += (uint64_t) (h0 >> 51);
+  r1 = (uint64_t) h1 & MASK51; h2 += (uint64_t) (h1 >> 51);
+  r2 = (uint64_t) h2 & MASK51; h3 += (uint64_t) (h2 >> 51);
+  r3 = (uint64_t) h3 & MASK51; h4 += (uint64_t) (h3 >> 51);
+  r4 = (uint64_t) h4 & MASK51; carry = (uint64_t) (h4 >> 51);
+
+  r0 += carry * 19;
+  carry = r0 >> 51; r1 += carry; r0 &= MASK51;
+
+  h[0] = r0;
+  h[1] = r1;
+  h[2] = r2;
+  h[3] = r3;
+  h[4] = r4;
+}
+
+void fe_0(fe h)
+{
+  h[0] = 0;
+  h[1] = 0;
+  h[2] = 0;
+  h[3] = 0;
+  h[4] = 0;
+}
+
+void fe_1(fe h)
+{
+  h[0] = 1;
+  h[1] = 0;
+  h[2] = 0;
+  h[3] = 0;
+  h[4] = 0;
+}
+
+void fe_add(fe h,const fe f,const fe g)
+{
+  h[0] = f[0] + g[0];
+  h[1] = f[1] + g[1];
+  h[2] = f[2] + g[2];
+  h[3] = f[3] + g[3];
+  h[4] = f[4] + g[4];
+}
+
+/*
+Replace (f,g) with (g,g) if b == 1;
+replace (f,g) with (f,g) if b == 0.
+
+Preconditions: b in {0,1}.
+*/
+
+void fe_cmov(fe f,const fe g,unsigned int b)
+{
+  uint64_t mask = -(uint64_t) b;
+  f[0] ^= (f[0] ^ g[0]) & mask;
+  f[1] ^= (f[1] ^ g[1]) & mask;
+  f[2] ^= (f[2] ^ g[2]) & mask;
+  f[3] ^= (f[3] ^ g[3]) & mask;
+  f[4] ^= (f[4] ^ g[4]) & mask;
+}
+
+void fe_copy(fe h,const fe f)
+{
+  h[0] = f[0];
+  h[1] = f[1];
+  h[2] = f[2];
+  h[3] = f[3];
+  h[4] = f[4];
+}
+
+/*
+Replace (f,g) with (g,f) if b == 1;
+replace (f,g) with (f,g) if b == 0.
+
+Preconditions: b in {0,1}.
+*/
+
+void fe_cswap(fe f,fe g,unsigned int b)
+{
+  uint64_t mask = -(uint64_t) b;
+  uint64_t x0 = (f[0] ^ g[0]) & mask;
+  uint64_t x1 = (f[1] ^ g[1]) & mask;
+  uint64_t x2 = (f[2] ^ g[2]) & mask;
+  uint64_t x3 = (f[3] ^ g[3]) & mask;
+  uint64_t x4 = (f[4] ^ g[4]) & mask;
+  f[0] ^= x0; g[0] ^= x0;
+  f[1] ^= x1; g[1] ^= x1;
+  f[2] ^= x2; g[2] ^= x2;
+  f[3] ^= x3; g[3] ^= x3;
+  f[4] ^= x4; g[4] ^= x4;
+}
+
+/*
+Ignores top bit of s.
+*/
+
+void fe_frombytes(fe h,const uint8_t *s)
+{
+  h[0] = load_8(s) & MASK51;
+  h[1] = (load_8(s + 6) >> 3) & MASK51;
+  h[2] = (load_8(s + 12) >> 6) & MASK51;
+  h[3] = (load_8(s + 19) >> 1) & MASK51;
+  h[4] = (load_8(s + 24) >> 12) & MASK51;
+}
+
+void fe_mul(fe h,const fe f,const fe g)
+{
+  uint64_t f0 = f[0];
+  uint64_t f1 = f[1];
+  uint64_t f2 = f[2];
+  uint64_t f3 = f[3];
+  uint64_t f4 = f[4];
+  uint64_t g0 = g[0];
+  uint64_t g1 = g[1];
+  uint64_t g2 = g[2];
+  uint64_t g3 = g[3];
+  uint64_t g4 = g[4];
+  uint64_t g1_19 = 19 * g1;
+  uint64_t g2_19 = 19 * g2;
+  uint64_t g3_19 = 19 * g3;
+  uint64_t g4_19 = 19 * g4;
+  uint128_t h0, h1, h2, h3, h4;
+
+  stats_count(field_mul,1);
+
+  h0 = (uint128_t) f0 * g0 + (uint128_t) f1 * g4_19 + (uint128_t) f2 * g3_19 +
+       (uint128_t) f3 * g2_19 + (uint128_t) f4 * g1_19;
+  h1 = (uint128_t) f0 * g1 + (uint128_t) f1 * g0 + (uint128_t) f2 * g4_19 +
+       (uint128_t) f3 * g3_19 + (uint128_t) f4 * g2_19;
+  h2 = (uint128_t) f0 * g2 + (uint128_t) f1 * g1 + (uint128_t) f2 * g0 +
+       (uint128_t) f3 * g4_19 + (uint128_t) f4 * g3_19;
+  h3 = (uint128_t) f0 * g3 + (uint128_t) f1 * g2 + (uint128_t) f2 * g1 +
+       (uint128_t) f3 * g0 + (uint128_t) f4 * g4_19;
+  h4 = (uint128_t) f0 * g4 + (uint128_t) f1 * g3 + (uint128_t) f2 * g2 +
+       (uint128_t) f3 * g1 + (uint128_t) f4 * g0;
+
+  fe_carry128(h,h0,h1,h2,h3,h4);
+}
+
+void fe_mul121666(fe h,const fe f)
+{
+  uint128_t h0 = (uint128_t) f[0] * 121666;
+  uint128_t h1 = (uint128_t) f[1] * 121666;
+  uint128_t h2 = (uint128_t) f[2] * 121666;
+  uint128_t h3 = (uint128_t) f[3] * 121666;
+  uint128_t h4 = (uint128_t) f[4] * 121666;
+
+  fe_carry128(h,h0,h1,h2,h3,h4);
+}
+
+/*
+h = -f
+*/
+
+void fe_neg(fe h,const fe f)
+{
+  fe zero;
+  fe_0(zero);
+  fe_sub(h,zero,f);
+}
+
+static void fe_sq_inner(fe h,const fe f,unsigned int shift)
+{
+  uint64_t f0 = f[0];
+  uint64_t f1 = f[1];
+  uint64_t f2 = f[2];
+  uint64_t f3 = f[3];
+  uint64_t f4 = f[4];
+  uint64_t f0_2 = 2 * f0;
+  uint64_t f1_2 = 2 * f1;
+  uint64_t f1_38 = 38 * f1;
+  uint64_t f2_38 = 38 * f2;
+  uint64_t f3_38 = 38 * f3;
+  uint64_t f3_19 = 19 * f3;
+  uint64_t f4_19 = 19 * f4;
+  uint128_t h0, h1, h2, h3, h4;
+
+  stats_count(field_mul,1);
+
+  h0 = (uint128_t) f0 * f0 + (uint128_t) f1_38 * f4 + (uint128_t) f2_38 * f3;
+  h1 = (uint128_t) f0_2 * f1 + (uint128_t) f2_38 * f4 + (uint128_t) f3_19 * f3;
+  h2 = (uint128_t) f0_2 * f2 + (uint128_t) f1 * f1 + (uint128_t) f3_38 * f4;
+  h3 = (uint128_t) f0_2 * f3 + (uint128_t) f1_2 * f2 + (uint128_t) f4_19 * f4;
+  h4 = (uint128_t) f0_2 * f4 + (uint128_t) f1_2 * f3 + (uint128_t) f2 * f2;
+
+  h0 <<= shift;
+  h1 <<= shift;
+  h2 <<= shift;
+  h3 <<= shift;
+  h4 <<= shift;
+
+  fe_carry128(h,h0,h1,h2,h3,h4);
+}
+
+void fe_sq(fe h,const fe f)
+{
+  fe_sq_inner(h,f,0);
+}
+
+/*
+h = 2 * f * f
+*/
+
+void fe_sq2(fe h,const fe f)
+{
+  fe_sq_inner(h,f,1);
+}
+
+/*
+h = f - g
+
+Computed as f + 4p - g, which keeps every limb positive.
+*/
+
+void fe_sub(fe h,const fe f,const fe g)
+{
+  fe_carry(h,
+    (f[0] + 0x1fffffffffffb4ULL) - g[0],
+    (f[1] + 0x1ffffffffffffcULL) - g[1],
+    (f[2] + 0x1ffffffffffffcULL) - g[2],
+    (f[3] + 0x1ffffffffffffcULL) - g[3],
+    (f[4] + 0x1ffffffffffffcULL) - g[4]);
+}
+
+/*
+Preconditions:
+  h bounded by 2^54 per limb.
+
+After the first carry pass h < 2^255 + 2^13, so q = floor((h + 19) / 2^255)
+is either 0 or 1, and h - q*p is the canonical representative.
+*/
+
+void fe_tobytes(uint8_t *s,const fe h)
+{
+  fe t;
+  uint64_t h0, h1, h2, h3, h4;
+  uint64_t q;
+
+  fe_carry(t,h[0],h[1],h[2],h[3],h[4]);
+  h0 = t[0];
+  h1 = t[1];
+  h2 = t[2];
+  h3 = t[3];
+  h4 = t[4];
+
+  q = (h0 + 19) >> 51;
+  q = (h1 + q) >> 51;
+  q = (h2 + q) >> 51;
+  q = (h3 + q) >> 51;
+  q = (h4 + q) >> 51;
+
+  h0 += 19 * q;
+
+  h1 += h0 >> 51; h0 &= MASK51;
+  h2 += h1 >> 51; h1 &= MASK51;
+  h3 += h2 >> 51; h2 &= MASK51;
+  h4 += h3 >> 51; h3 &= MASK51;
+                  h4 &= MASK51;
+
+  h0 = h0 | (h1 << 51);
+  h1 = (h1 >> 13) | (h2 << 38);
+  h2 = (h2 >> 26) | (h3 << 25);
+  h3 = (h3 >> 39) | (h4 << 12);
+
+  s[0] = h0 >> 0;
+  s[1] = h0 >> 8;
+  s[2] = h0 >> 16;
+  s[3] = h0 >> 24;
+  s[4] = h0 >> 32;
+  s[5] = h0 >> 40;
+  s[6] = h0 >> 48;
+  s[7] = h0 >> 56;
+  s[8] = h1 >> 0;
+  s[9] = h1 >> 8;
+  s[10] = h1 >> 16;
+  s[11] = h1 >> 24;
+  s[12] = h1 >> 32;
+  s[13] = h1 >> 40;
+  s[14] = h1 >> 48;
+  s[15] = h1 >> 56;
+  s[16] = h2 >> 0;
+  s[17] = h2 >> 8;
+  s[18] = h2 >> 16;
+  s[19] = h2 >> 24;
+  s[20] = h2 >> 32;
+  s[21] = h2 >> 40;
+  s[22] = h2 >> 48;
+  s[23] = h2 >> 56;
+  s[24] = h3 >> 0;
+  s[25] = h3 >> 8;
+  s[26] = h3 >> 16;
+  s[27] = h3 >> 24;
+  s[28] = h3 >> 32;
+  s[29] = h3 >> 40;
+  s[30] = h3 >> 48;
+  s[31] = h3 >> 56;
+}
+
+#endif
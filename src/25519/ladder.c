@@ -0,0 +1,467 @@
+#include "src/25519/ladder.h"
+#include "src/stats.h"
+
+/* A Montgomery ladder for Curve25519 which uses AVX2 to run four field
+ * multiplications at once. Each 256-bit vector holds one limb of four field
+ * elements, stored as ten unsigned limbs of alternating 26 and 25 bits, so
+ * that all products can be computed with vpmuludq.
+
+ * The ladder state [x3, z3, x2, z2] is kept in the four lanes, and every step
+ * is done with three vector multiplications:
+
+     [C, D, A, B] * [B, A, A, B] = [CB, DA, AA, BB]
+     [DA+CB, DA-CB, AA, -E] * [DA+CB, DA-CB, BB, 121665] = [x3', t, x2', -121665E]
+     [x3', t, x2', -E] * [1, x1, 1, -121665E-AA] = [x3', z3', x2', z2']
+
+ * where A = x2+z2, B = x2-z2, C = x3+z3, D = x3-z3 and E = AA-BB. The lanes
+ * are arranged so that almost every operand is already in place, and only
+ * two of the shuffles per step have to cross the 128-bit halves. Outputs of
+ * fe4_mul have limbs below 2^26 plus a small carry. */
+
+#if defined(NECTAR_25519_LADDER_AVX2)
+
+#include <immintrin.h>
+
+#define AVX2 __attribute__((target("avx2")))
+
+typedef __m256i fe4[10];
+
+#define add(a,b) _mm256_add_epi64(a,b)
+#define mul(a,b) _mm256_mul_epu32(a,b)
+
+/* Lane selectors for fe4_perm and fe4_blend. fe4_swap exchanges the lanes
+ * within each half. */
+#define PERM(a,b,c,d) ((a) | ((b) << 2) | ((c) << 4) | ((d) << 6))
+#define LANES(a,b,c,d) (3 * ((a) | ((b) << 2) | ((c) << 4) | ((d) << 6)))
+
+#define fe4_perm(h,f,imm) \
+  do { \
+    h[0] = _mm256_permute4x64_epi64(f[0],imm); \
+    h[1] = _mm256_permute4x64_epi64(f[1],imm); \
+    h[2] = _mm256_permute4x64_epi64(f[2],imm); \
+    h[3] = _mm256_permute4x64_epi64(f[3],imm); \
+    h[4] = _mm256_permute4x64_epi64(f[4],imm); \
+    h[5] = _mm256_permute4x64_epi64(f[5],imm); \
+    h[6] = _mm256_permute4x64_epi64(f[6],imm); \
+    h[7] = _mm256_permute4x64_epi64(f[7],imm); \
+    h[8] = _mm256_permute4x64_epi64(f[8],imm); \
+    h[9] = _mm256_permute4x64_epi64(f[9],imm); \
+  } while (0)
+
+#define fe4_swap(h,f) \
+  do { \
+    h[0] = _mm256_shuffle_epi32(f[0],PERM(2,3,0,1)); \
+    h[1] = _mm256_shuffle_epi32(f[1],PERM(2,3,0,1)); \
+    h[2] = _mm256_shuffle_epi32(f[2],PERM(2,3,0,1)); \
+    h[3] = _mm256_shuffle_epi32(f[3],PERM(2,3,0,1)); \
+    h[4] = _mm256_shuffle_epi32(f[4],PERM(2,3,0,1)); \
+    h[5] = _mm256_shuffle_epi32(f[5],PERM(2,3,0,1)); \
+    h[6] = _mm256_shuffle_epi32(f[6],PERM(2,3,0,1)); \
+    h[7] = _mm256_shuffle_epi32(f[7],PERM(2,3,0,1)); \
+    h[8] = _mm256_shuffle_epi32(f[8],PERM(2,3,0,1)); \
+    h[9] = _mm256_shuffle_epi32(f[9],PERM(2,3,0,1)); \
+  } while (0)
+
+#define fe4_blend(h,f,g,imm) \
+  do { \
+    h[0] = _mm256_blend_epi32(f[0],g[0],imm); \
+    h[1] = _mm256_blend_epi32(f[1],g[1],imm); \
+    h[2] = _mm256_blend_epi32(f[2],g[2],imm); \
+    h[3] = _mm256_blend_epi32(f[3],g[3],imm); \
+    h[4] = _mm256_blend_epi32(f[4],g[4],imm); \
+    h[5] = _mm256_blend_epi32(f[5],g[5],imm); \
+    h[6] = _mm256_blend_epi32(f[6],g[6],imm); \
+    h[7] = _mm256_blend_epi32(f[7],g[7],imm); \
+    h[8] = _mm256_blend_epi32(f[8],g[8],imm); \
+    h[9] = _mm256_blend_epi32(f[9],g[9],imm); \
+  } while (0)
+
+static uint32_t load_4(const uint8_t *in)
+{
+  uint32_t result;
+  result = (uint32_t) in[0];
+  result |= ((uint32_t) in[1]) << 8;
+  result |= ((uint32_t) in[2]) << 16;
+  result |= ((uint32_t) in[3]) << 24;
+  return result;
+}
+
+/*
+Ignores top bit of s.
+*/
+
+static void frombytes(uint64_t h[10],const uint8_t *s)
+{
+  h[0] = (load_4(s + 0) >> 0) & 0x3ffffff;
+  h[1] = (load_4(s + 3) >> 2) & 0x1ffffff;
+  h[2] = (load_4(s + 6) >> 3) & 0x3ffffff;
+  h[3] = (load_4(s + 9) >> 5) & 0x1ffffff;
+  h[4] = (load_4(s + 12) >> 6) & 0x3ffffff;
+  h[5] = (load_4(s + 16) >> 0) & 0x1ffffff;
+  h[6] = (load_4(s + 19) >> 1) & 0x3ffffff;
+  h[7] = (load_4(s + 22) >> 3) & 0x1ffffff;
+  h[8] = (load_4(s + 25) >> 4) & 0x3ffffff;
+  h[9] = (load_4(s + 28) >> 6) & 0x1ffffff;
+}
+
+/*
+Fully reduces h, which may have limbs of up to 2^62.
+*/
+
+static void tobytes(uint8_t *s,const uint64_t f[10])
+{
+  uint64_t h[10];
+  uint64_t q, acc;
+  int i, j, bits;
+
+  for (i = 0;i < 10;++i) h[i] = f[i];
+
+  for (i = 0;i < 9;++i) {
+    h[i + 1] += h[i] >> (26 - (i & 1));
+    h[i] &= (1 << (26 - (i & 1))) - 1;
+  }
+  h[0] += 19 * (h[9] >> 25);
+  h[9] &= 0x1ffffff;
+
+  q = (h[0] + 19) >> 26;
+  for (i = 1;i < 10;++i) q = (h[i] + q) >> (26 - (i & 1));
+
+  h[0] += 19 * q;
+
+  for (i = 0;i < 9;++i) {
+    h[i + 1] += h[i] >> (26 - (i & 1));
+    h[i] &= (1 << (26 - (i & 1))) - 1;
+  }
+  h[9] &= 0x1ffffff;
+
+  acc = 0;
+  bits = 0;
+  j = 0;
+  for (i = 0;i < 10;++i) {
+    acc |= h[i] << bits;
+    bits += 26 - (i & 1);
+    while (bits >= 8) {
+      s[j++] = (uint8_t) acc;
+      acc >>= 8;
+      bits -= 8;
+    }
+  }
+  s[j] = (uint8_t) acc;
+}
+
+AVX2 static void fe4_add(fe4 h,const fe4 f,const fe4 g)
+{
+  h[0] = add(f[0],g[0]);
+  h[1] = add(f[1],g[1]);
+  h[2] = add(f[2],g[2]);
+  h[3] = add(f[3],g[3]);
+  h[4] = add(f[4],g[4]);
+  h[5] = add(f[5],g[5]);
+  h[6] = add(f[6],g[6]);
+  h[7] = add(f[7],g[7]);
+  h[8] = add(f[8],g[8]);
+  h[9] = add(f[9],g[9]);
+}
+
+/*
+h = f - g, computed as f + 2p - g.
+*/
+
+AVX2 static void fe4_sub(fe4 h,const fe4 f,const fe4 g)
+{
+  __m256i p0 = _mm256_set1_epi64x(0x7ffffda);
+  __m256i p1 = _mm256_set1_epi64x(0x3fffffe);
+  __m256i p2 = _mm256_set1_epi64x(0x7fffffe);
+  h[0] = _mm256_sub_epi64(add(f[0],p0),g[0]);
+  h[1] = _mm256_sub_epi64(add(f[1],p1),g[1]);
+  h[2] = _mm256_sub_epi64(add(f[2],p2),g[2]);
+  h[3] = _mm256_sub_epi64(add(f[3],p1),g[3]);
+  h[4] = _mm256_sub_epi64(add(f[4],p2),g[4]);
+  h[5] = _mm256_sub_epi64(add(f[5],p1),g[5]);
+  h[6] = _mm256_sub_epi64(add(f[6],p2),g[6]);
+  h[7] = _mm256_sub_epi64(add(f[7],p1),g[7]);
+  h[8] = _mm256_sub_epi64(add(f[8],p2),g[8]);
+  h[9] = _mm256_sub_epi64(add(f[9],p1),g[9]);
+}
+
+#define CARRY(a,b,bits,m) \
+  do { \
+    __m256i c_ = _mm256_srli_epi64(a,bits); \
+    b = add(b,c_); \
+    a = _mm256_and_si256(a,m); \
+  } while (0)
+
+/*
+Preconditions:
+   f and g bounded by 1.5*2^27 per even limb and 1.6*2^26 per odd limb.
+
+Products of these are below 2^59.5, so sums of ten of them fit in 64 bits.
+*/
+
+AVX2 static void fe4_mul(fe4 out,const fe4 f,const fe4 g)
+{
+  __m256i k19 = _mm256_set1_epi64x(19);
+  __m256i m25 = _mm256_set1_epi64x(0x1ffffff);
+  __m256i m26 = _mm256_set1_epi64x(0x3ffffff);
+  __m256i g19[10];
+  __m256i h0, h1, h2, h3, h4, h5, h6, h7, h8, h9;
+  __m256i fi, fi_2;
+  __m256i c;
+
+  stats_count(field_mul,4);
+
+  g19[1] = mul(g[1],k19);
+  g19[2] = mul(g[2],k19);
+  g19[3] = mul(g[3],k19);
+  g19[4] = mul(g[4],k19);
+  g19[5] = mul(g[5],k19);
+  g19[6] = mul(g[6],k19);
+  g19[7] = mul(g[7],k19);
+  g19[8] = mul(g[8],k19);
+  g19[9] = mul(g[9],k19);
+
+  fi = f[0];
+  h0 = mul(fi,g[0]);
+  h1 = mul(fi,g[1]);
+  h2 = mul(fi,g[2]);
+  h3 = mul(fi,g[3]);
+  h4 = mul(fi,g[4]);
+  h5 = mul(fi,g[5]);
+  h6 = mul(fi,g[6]);
+  h7 = mul(fi,g[7]);
+  h8 = mul(fi,g[8]);
+  h9 = mul(fi,g[9]);
+
+  fi = f[1];
+  fi_2 = add(fi,fi);
+  h0 = add(h0,mul(fi_2,g19[9]));
+  h1 = add(h1,mul(fi,g[0]));
+  h2 = add(h2,mul(fi_2,g[1]));
+  h3 = add(h3,mul(fi,g[2]));
+  h4 = add(h4,mul(fi_2,g[3]));
+  h5 = add(h5,mul(fi,g[4]));
+  h6 = add(h6,mul(fi_2,g[5]));
+  h7 = add(h7,mul(fi,g[6]));
+  h8 = add(h8,mul(fi_2,g[7]));
+  h9 = add(h9,mul(fi,g[8]));
+
+  fi = f[2];
+  h0 = add(h0,mul(fi,g19[8]));
+  h1 = add(h1,mul(fi,g19[9]));
+  h2 = add(h2,mul(fi,g[0]));
+  h3 = add(h3,mul(fi,g[1]));
+  h4 = add(h4,mul(fi,g[2]));
+  h5 = add(h5,mul(fi,g[3]));
+  h6 = add(h6,mul(fi,g[4]));
+  h7 = add(h7,mul(fi,g[5]));
+  h8 = add(h8,mul(fi,g[6]));
+  h9 = add(h9,mul(fi,g[7]));
+
+  fi = f[3];
+  fi_2 = add(fi,fi);
+  h0 = add(h0,mul(fi_2,g19[7]));
+  h1 = add(h1,mul(fi,g19[8]));
+  h2 = add(h2,mul(fi_2,g19[9]));
+  h3 = add(h3,mul(fi,g[0]));
+  h4 = add(h4,mul(fi_2,g[1]));
+  h5 = add(h5,mul(fi,g[2]));
+  h6 = add(h6,mul(fi_2,g[3]));
+  h7 = add(h7,mul(fi,g[4]));
+  h8 = add(h8,mul(fi_2,g[5]));
+  h9 = add(h9,mul(fi,g[6]));
+
+  fi = f[4];
+  h0 = add(h0,mul(fi,g19[6]));
+  h1 = add(h1,mul(fi,g19[7]));
+  h2 = add(h2,mul(fi,g19[8]));
+  h3 = add(h3,mul(fi,g19[9]));
+  h4 = add(h4,mul(fi,g[0]));
+  h5 = add(h5,mul(fi,g[1]));
+  h6 = add(h6,mul(fi,g[2]));
+  h7 = add(h7,mul(fi,g[3]));
+  h8 = add(h8,mul(fi,g[4]));
+  h9 = add(h9,mul(fi,g[5]));
+
+  fi = f[5];
+  fi_2 = add(fi,fi);
+  h0 = add(h0,mul(fi_2,g19[5]));
+  h1 = add(h1,mul(fi,g19[6]));
+  h2 = add(h2,mul(fi_2,g19[7]));
+  h3 = add(h3,mul(fi,g19[8]));
+  h4 = add(h4,mul(fi_2,g19[9]));
+  h5 = add(h5,mul(fi,g[0]));
+  h6 = add(h6,mul(fi_2,g[1]));
+  h7 = add(h7,mul(fi,g[2]));
+  h8 = add(h8,mul(fi_2,g[3]));
+  h9 = add(h9,mul(fi,g[4]));
+
+  fi = f[6];
+  h0 = add(h0,mul(fi,g19[4]));
+  h1 = add(h1,mul(fi,g19[5]));
+  h2 = add(h2,mul(fi,g19[6]));
+  h3 = add(h3,mul(fi,g19[7]));
+  h4 = add(h4,mul(fi,g19[8]));
+  h5 = add(h5,mul(fi,g19[9]));
+  h6 = add(h6,mul(fi,g[0]));
+  h7 = add(h7,mul(fi,g[1]));
+  h8 = add(h8,mul(fi,g[2]));
+  h9 = add(h9,mul(fi,g[3]));
+
+  fi = f[7];
+  fi_2 = add(fi,fi);
+  h0 = add(h0,mul(fi_2,g19[3]));
+  h1 = add(h1,mul(fi,g19[4]));
+  h2 = add(h2,mul(fi_2,g19[5]));
+  h3 = add(h3,mul(fi,g19[6]));
+  h4 = add(h4,mul(fi_2,g19[7]));
+  h5 = add(h5,mul(fi,g19[8]));
+  h6 = add(h6,mul(fi_2,g19[9]));
+  h7 = add(h7,mul(fi,g[0]));
+  h8 = add(h8,mul(fi_2,g[1]));
+  h9 = add(h9,mul(fi,g[2]));
+
+  fi = f[8];
+  h0 = add(h0,mul(fi,g19[2]));
+  h1 = add(h1,mul(fi,g19[3]));
+  h2 = add(h2,mul(fi,g19[4]));
+  h3 = add(h3,mul(fi,g19[5]));
+  h4 = add(h4,mul(fi,g19[6]));
+  h5 = add(h5,mul(fi,g19[7]));
+  h6 = add(h6,mul(fi,g19[8]));
+  h7 = add(h7,mul(fi,g19[9]));
+  h8 = add(h8,mul(fi,g[0]));
+  h9 = add(h9,mul(fi,g[1]));
+
+  fi = f[9];
+  fi_2 = add(fi,fi);
+  h0 = add(h0,mul(fi_2,g19[1]));
+  h1 = add(h1,mul(fi,g19[2]));
+  h2 = add(h2,mul(fi_2,g19[3]));
+  h3 = add(h3,mul(fi,g19[4]));
+  h4 = add(h4,mul(fi_2,g19[5]));
+  h5 = add(h5,mul(fi,g19[6]));
+  h6 = add(h6,mul(fi_2,g19[7]));
+  h7 = add(h7,mul(fi,g19[8]));
+  h8 = add(h8,mul(fi_2,g19[9]));
+  h9 = add(h9,mul(fi,g[0]));
+
+  CARRY(h0,h1,26,m26); CARRY(h4,h5,26,m26);
+  CARRY(h1,h2,25,m25); CARRY(h5,h6,25,m25);
+  CARRY(h2,h3,26,m26); CARRY(h6,h7,26,m26);
+  CARRY(h3,h4,25,m25); CARRY(h7,h8,25,m25);
+  CARRY(h4,h5,26,m26); CARRY(h8,h9,26,m26);
+
+  c = _mm256_srli_epi64(h9,25);
+  h9 = _mm256_and_si256(h9,m25);
+  h0 = add(h0,add(add(_mm256_slli_epi64(c,4),_mm256_slli_epi64(c,1)),c));
+
+  CARRY(h0,h1,26,m26);
+
+  out[0] = h0;
+  out[1] = h1;
+  out[2] = h2;
+  out[3] = h3;
+  out[4] = h4;
+  out[5] = h5;
+  out[6] = h6;
+  out[7] = h7;
+  out[8] = h8;
+  out[9] = h9;
+}
+
+/*
+Replace [x3, z3, x2, z2] with [x2, z2, x3, z3] if b == 1.
+*/
+
+AVX2 static void fe4_cswap(fe4 h,unsigned int b)
+{
+  __m256i mask = _mm256_set1_epi64x(-(int64_t) b);
+  __m256i t;
+  int i;
+
+  for (i = 0;i < 10;++i) {
+    t = _mm256_permute4x64_epi64(h[i],PERM(2,3,0,1));
+    h[i] = _mm256_xor_si256(h[i],_mm256_and_si256(_mm256_xor_si256(h[i],t),mask));
+  }
+}
+
+/*
+One ladder step, as described above. k holds [1, x1, 1, 121665].
+
+Sums and differences are not carried before they are multiplied, which
+fe4_mul allows for.
+*/
+
+AVX2 static void fe4_step(fe4 h,const fe4 k)
+{
+  fe4 s, t, u, v;
+
+  /* [C, D, A, B] */
+  fe4_swap(t,h);
+  fe4_add(s,h,t);
+  fe4_sub(t,t,h);
+  fe4_blend(u,s,t,LANES(0,1,0,1));
+
+  /* [CB, DA, AA, BB] */
+  fe4_perm(v,u,PERM(3,2,2,3));
+  fe4_mul(u,u,v);
+
+  /* s = [DA+CB, ., ., .], t = [., DA-CB, ., -E] and v = [., ., BB, AA] */
+  fe4_swap(v,u);
+  fe4_add(s,u,v);
+  fe4_sub(t,u,v);
+
+  /* [x3', t, x2', -121665E] */
+  fe4_blend(s,s,t,LANES(0,1,0,1));
+  fe4_blend(h,s,u,LANES(0,0,1,0));
+  fe4_blend(s,s,v,LANES(0,0,1,0));
+  fe4_blend(s,s,k,LANES(0,0,0,1));
+  fe4_mul(s,h,s);
+
+  /* [x3', z3', x2', z2'] */
+  fe4_sub(v,s,v);
+  fe4_blend(v,k,v,LANES(0,0,0,1));
+  fe4_blend(s,s,t,LANES(0,0,0,1));
+  fe4_mul(h,s,v);
+}
+
+/*
+Computes the projective coordinates of n*p, using the bits 0..254 of n.
+*/
+
+AVX2 void ladder_avx2(uint8_t x[32],uint8_t z[32],const uint8_t n[32],const uint8_t p[32])
+{
+  uint64_t x1[10];
+  uint64_t out[2][10];
+  uint64_t t[4];
+  fe4 h, k;
+  unsigned int b, s = 0;
+  int i, pos;
+
+  frombytes(x1,p);
+
+  for (i = 0;i < 10;++i) {
+    h[i] = _mm256_setr_epi64x((int64_t) x1[i],i == 0,i == 0,0);
+    k[i] = _mm256_setr_epi64x(i == 0,(int64_t) x1[i],i == 0,i == 0 ? 121665 : 0);
+  }
+
+  for (pos = 254;pos >= 0;--pos) {
+    b = (n[pos / 8] >> (pos & 7)) & 1;
+    s ^= b;
+    fe4_cswap(h,s);
+    s = b;
+    fe4_step(h,k);
+  }
+  fe4_cswap(h,s);
+
+  for (i = 0;i < 10;++i) {
+    _mm256_storeu_si256((__m256i *) (void *) t,h[i]);
+    out[0][i] = t[2];
+    out[1][i] = t[3];
+  }
+
+  tobytes(x,out[0]);
+  tobytes(z,out[1]);
+}
+
+#endif
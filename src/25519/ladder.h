@@ -0,0 +1,23 @@
+#ifndef LIBNECTAR_25519_LADDER_H
+#define LIBNECTAR_25519_LADDER_H
+
+#include "include/nectar.h"
+#include "src/25519/fe.h"
+
+/* The vectorized ladder needs AVX2, which is detected at runtime. It is only
+ * built alongside the 26/25-bit field arithmetic, where it halves the time of
+ * a scalar multiplication. The 51-bit backend's scalar ladder is already as
+ * fast as the vectorized one, so running it there would gain nothing, even
+ * though it takes and returns bytes and could be used with either backend. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) &&         \
+    !defined(NECTAR_25519_FE51)
+#define NECTAR_25519_LADDER_AVX2
+#endif
+
+/* Namespacing. */
+#define  ladder_avx2  nectar__25519_ladder_avx2
+
+/* Functions. */
+void ladder_avx2(uint8_t x[32], uint8_t z[32], const uint8_t n[32], const uint8_t p[32]);
+
+#endif
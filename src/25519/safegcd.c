@@ -0,0 +1,372 @@
+#include "src/25519/fe.h"
+#include "src/stats.h"
+
+/* Field inversion with the safegcd algorithm from "Fast constant-time gcd
+ * computation and modular inversion" (Bernstein, Yang; 2019), in the form
+ * used by libsecp256k1: batches of divsteps are applied to 2x2 transition
+ * matrices on 62-bit words, which are then applied to the full-size numbers.
+
+ * Numbers are stored as five signed limbs of 62 bits each (the topmost limb
+ * holding the sign), independent of the representation of field elements. */
+
+#if defined(NECTAR_25519_SAFEGCD)
+
+__extension__ typedef __int128 int128_t;
+
+typedef struct { int64_t v[5]; } signed62;
+typedef struct { int64_t u, v, q, r; } trans2x2;
+
+#define M62 ((int64_t) (((uint64_t) -1) >> 2))
+
+/* p = 2^255 - 19 = -19 + 128 * 2^248, and its inverse modulo 2^62. */
+#define P0 ((int64_t) -19)
+#define P4 ((int64_t) 128)
+#define PINV62 ((uint64_t) 0x39435e50d79435e5ULL)
+
+static const signed62 modulus = {{ P0, 0, 0, 0, P4 }};
+
+static void fe_tosigned62(signed62 *r,const fe f)
+{
+  uint8_t s[32];
+  uint64_t w[4];
+  int i, j;
+
+  fe_tobytes(s,f);
+  for (i = 0;i < 4;++i) {
+    w[i] = 0;
+    for (j = 7;j >= 0;--j) w[i] = (w[i] << 8) | s[8 * i + j];
+  }
+
+  r->v[0] = (int64_t) (w[0] & M62);
+  r->v[1] = (int64_t) (((w[0] >> 62) | (w[1] << 2)) & M62);
+  r->v[2] = (int64_t) (((w[1] >> 60) | (w[2] << 4)) & M62);
+  r->v[3] = (int64_t) (((w[2] >> 58) | (w[3] << 6)) & M62);
+  r->v[4] = (int64_t) (w[3] >> 56);
+}
+
+/*
+Preconditions: r in [0,p).
+*/
+
+static void fe_fromsigned62(fe h,const signed62 *r)
+{
+  uint64_t a0 = (uint64_t) r->v[0];
+  uint64_t a1 = (uint64_t) r->v[1];
+  uint64_t a2 = (uint64_t) r->v[2];
+  uint64_t a3 = (uint64_t) r->v[3];
+  uint64_t a4 = (uint64_t) r->v[4];
+  uint64_t w[4];
+  uint8_t s[32];
+  int i, j;
+
+  w[0] = a0 | (a1 << 62);
+  w[1] = (a1 >> 2) | (a2 << 60);
+  w[2] = (a2 >> 4) | (a3 << 58);
+  w[3] = (a3 >> 6) | (a4 << 56);
+  for (i = 0;i < 4;++i)
+    for (j = 0;j < 8;++j) s[8 * i + j] = (uint8_t) (w[i] >> (8 * j));
+
+  fe_frombytes(h,s);
+}
+
+/*
+Performs 59 divsteps on the bottom 64 bits of f and g, in constant time, and
+returns the transition matrix scaled by 2^62. zeta is -(delta+1/2).
+*/
+
+static int64_t divsteps_59(int64_t zeta,uint64_t f0,uint64_t g0,trans2x2 *t)
+{
+  uint64_t u = 8, v = 0, q = 0, r = 8;
+  volatile uint64_t c1, c2;
+  uint64_t mask1, mask2, f = f0, g = g0, x, y, z;
+  int i;
+
+  for (i = 3;i < 62;++i) {
+    c1 = (uint64_t) (zeta >> 63);
+    mask1 = c1;
+    c2 = g & 1;
+    mask2 = -c2;
+    x = (f ^ mask1) - mask1;
+    y = (u ^ mask1) - mask1;
+    z = (v ^ mask1) - mask1;
+    g += x & mask2;
+    q += y & mask2;
+    r += z & mask2;
+    mask1 &= mask2;
+    zeta = (zeta ^ (int64_t) mask1) - 1;
+    f += g & mask1;
+    u += q & mask1;
+    v += r & mask1;
+    g >>= 1;
+    u <<= 1;
+    v <<= 1;
+  }
+
+  t->u = (int64_t) u;
+  t->v = (int64_t) v;
+  t->q = (int64_t) q;
+  t->r = (int64_t) r;
+  return zeta;
+}
+
+static int ctz64(uint64_t x)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(x);
+#else
+  int n = 0;
+  while (!(x & 1)) { x >>= 1; ++n; }
+  return n;
+#endif
+}
+
+/*
+Performs 62 divsteps on the bottom 64 bits of f and g, in variable time, and
+returns the transition matrix scaled by 2^62. eta is -delta.
+*/
+
+static int64_t divsteps_62_var(int64_t eta,uint64_t f0,uint64_t g0,trans2x2 *t)
+{
+  uint64_t u = 1, v = 0, q = 0, r = 1;
+  uint64_t f = f0, g = g0, m, w, tmp;
+  int i = 62, limit, zeros;
+
+  for (;;) {
+    /* Divide g by two as often as possible, stopping after i steps. */
+    zeros = ctz64(g | (((uint64_t) -1) << i));
+    g >>= zeros;
+    u <<= zeros;
+    v <<= zeros;
+    eta -= zeros;
+    i -= zeros;
+    if (i == 0) break;
+
+    /* Cancel out as many of the bottom bits of g as possible. */
+    if (eta < 0) {
+      eta = -eta;
+      tmp = f; f = g; g = -tmp;
+      tmp = u; u = q; q = -tmp;
+      tmp = v; v = r; r = -tmp;
+      limit = ((int) eta + 1) > i ? i : ((int) eta + 1);
+      m = (((uint64_t) -1) >> (64 - limit)) & 63;
+      w = (f * g * (f * f - 2)) & m;
+    } else {
+      limit = ((int) eta + 1) > i ? i : ((int) eta + 1);
+      m = (((uint64_t) -1) >> (64 - limit)) & 15;
+      w = f + (((f + 1) & 4) << 1);
+      w = (-w * g) & m;
+    }
+    g += f * w;
+    q += u * w;
+    r += v * w;
+  }
+
+  t->u = (int64_t) u;
+  t->v = (int64_t) v;
+  t->q = (int64_t) q;
+  t->r = (int64_t) r;
+  return eta;
+}
+
+/*
+Computes (t/2^62) * [d, e] mod p, keeping d and e in (-2p,p).
+*/
+
+static void update_de(signed62 *d,signed62 *e,const trans2x2 *t)
+{
+  const int64_t d0 = d->v[0], d1 = d->v[1], d2 = d->v[2], d3 = d->v[3], d4 = d->v[4];
+  const int64_t e0 = e->v[0], e1 = e->v[1], e2 = e->v[2], e3 = e->v[3], e4 = e->v[4];
+  const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+  int64_t md, me, sd, se;
+  int128_t cd, ce;
+
+  /* Add [u, q] if d is negative, and [v, r] if e is negative. */
+  sd = d4 >> 63;
+  se = e4 >> 63;
+  md = (u & sd) + (v & se);
+  me = (q & sd) + (r & se);
+
+  /* Pick md and me so that the bottom 62 bits of t*[d,e] + p*[md,me] are
+     zero, and shift them out. */
+  cd = (int128_t) u * d0 + (int128_t) v * e0;
+  ce = (int128_t) q * d0 + (int128_t) r * e0;
+  md -= (int64_t) ((PINV62 * (uint64_t) cd + (uint64_t) md) & (uint64_t) M62);
+  me -= (int64_t) ((PINV62 * (uint64_t) ce + (uint64_t) me) & (uint64_t) M62);
+  cd += (int128_t) P0 * md;
+  ce += (int128_t) P0 * me;
+  cd >>= 62;
+  ce >>= 62;
+
+  cd += (int128_t) u * d1 + (int128_t) v * e1;
+  ce += (int128_t) q * d1 + (int128_t) r * e1;
+  d->v[0] = (int64_t) cd & M62; cd >>= 62;
+  e->v[0] = (int64_t) ce & M62; ce >>= 62;
+
+  cd += (int128_t) u * d2 + (int128_t) v * e2;
+  ce += (int128_t) q * d2 + (int128_t) r * e2;
+  d->v[1] = (int64_t) cd & M62; cd >>= 62;
+  e->v[1] = (int64_t) ce & M62; ce >>= 62;
+
+  cd += (int128_t) u * d3 + (int128_t) v * e3;
+  ce += (int128_t) q * d3 + (int128_t) r * e3;
+  d->v[2] = (int64_t) cd & M62; cd >>= 62;
+  e->v[2] = (int64_t) ce & M62; ce >>= 62;
+
+  cd += (int128_t) u * d4 + (int128_t) v * e4;
+  ce += (int128_t) q * d4 + (int128_t) r * e4;
+  cd += (int128_t) P4 * md;
+  ce += (int128_t) P4 * me;
+  d->v[3] = (int64_t) cd & M62; cd >>= 62;
+  e->v[3] = (int64_t) ce & M62; ce >>= 62;
+
+  d->v[4] = (int64_t) cd;
+  e->v[4] = (int64_t) ce;
+}
+
+/*
+Computes (t/2^62) * [f, g], using only the bottom len limbs.
+*/
+
+static void update_fg(int len,signed62 *f,signed62 *g,const trans2x2 *t)
+{
+  const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+  int64_t fi, gi;
+  int128_t cf, cg;
+  int i;
+
+  fi = f->v[0];
+  gi = g->v[0];
+  cf = (int128_t) u * fi + (int128_t) v * gi;
+  cg = (int128_t) q * fi + (int128_t) r * gi;
+  cf >>= 62;
+  cg >>= 62;
+
+  for (i = 1;i < len;++i) {
+    fi = f->v[i];
+    gi = g->v[i];
+    cf += (int128_t) u * fi + (int128_t) v * gi;
+    cg += (int128_t) q * fi + (int128_t) r * gi;
+    f->v[i - 1] = (int64_t) cf & M62; cf >>= 62;
+    g->v[i - 1] = (int64_t) cg & M62; cg >>= 62;
+  }
+
+  f->v[len - 1] = (int64_t) cf;
+  g->v[len - 1] = (int64_t) cg;
+}
+
+/*
+Brings r from (-2p,p) to [0,p), negating it if sign is negative.
+*/
+
+static void normalize(signed62 *r,int64_t sign)
+{
+  int64_t r0 = r->v[0], r1 = r->v[1], r2 = r->v[2], r3 = r->v[3], r4 = r->v[4];
+  volatile int64_t cond_add, cond_negate;
+
+  cond_add = r4 >> 63;
+  r0 += P0 & cond_add;
+  r4 += P4 & cond_add;
+  cond_negate = sign >> 63;
+  r0 = (r0 ^ cond_negate) - cond_negate;
+  r1 = (r1 ^ cond_negate) - cond_negate;
+  r2 = (r2 ^ cond_negate) - cond_negate;
+  r3 = (r3 ^ cond_negate) - cond_negate;
+  r4 = (r4 ^ cond_negate) - cond_negate;
+  r1 += r0 >> 62; r0 &= M62;
+  r2 += r1 >> 62; r1 &= M62;
+  r3 += r2 >> 62; r2 &= M62;
+  r4 += r3 >> 62; r3 &= M62;
+
+  cond_add = r4 >> 63;
+  r0 += P0 & cond_add;
+  r4 += P4 & cond_add;
+  r1 += r0 >> 62; r0 &= M62;
+  r2 += r1 >> 62; r1 &= M62;
+  r3 += r2 >> 62; r2 &= M62;
+  r4 += r3 >> 62; r3 &= M62;
+
+  r->v[0] = r0;
+  r->v[1] = r1;
+  r->v[2] = r2;
+  r->v[3] = r3;
+  r->v[4] = r4;
+}
+
+/*
+Inverts z in constant time; 0 is mapped to 0.
+*/
+
+void fe_invert(fe out,const fe z)
+{
+  signed62 d = {{ 0, 0, 0, 0, 0 }};
+  signed62 e = {{ 1, 0, 0, 0, 0 }};
+  signed62 f = modulus;
+  signed62 g;
+  trans2x2 t;
+  int64_t zeta = -1;
+  int i;
+
+  stats_count(field_invert,1);
+
+  fe_tosigned62(&g,z);
+
+  /* 10 * 59 = 590 divsteps are enough for any 256-bit input. */
+  for (i = 0;i < 10;++i) {
+    zeta = divsteps_59(zeta,(uint64_t) f.v[0],(uint64_t) g.v[0],&t);
+    update_de(&d,&e,&t);
+    update_fg(5,&f,&g,&t);
+  }
+
+  normalize(&d,f.v[4]);
+  fe_fromsigned62(out,&d);
+}
+
+/*
+Inverts z in variable time; 0 is mapped to 0. Only for public inputs.
+*/
+
+void fe_invert_vartime(fe out,const fe z)
+{
+  signed62 d = {{ 0, 0, 0, 0, 0 }};
+  signed62 e = {{ 1, 0, 0, 0, 0 }};
+  signed62 f = modulus;
+  signed62 g;
+  trans2x2 t;
+  int64_t eta = -1;
+  int64_t cond, fn, gn;
+  int j, len = 5;
+
+  stats_count(field_invert,1);
+
+  fe_tosigned62(&g,z);
+
+  for (;;) {
+    eta = divsteps_62_var(eta,(uint64_t) f.v[0],(uint64_t) g.v[0],&t);
+    update_de(&d,&e,&t);
+    update_fg(len,&f,&g,&t);
+
+    /* Stop once g is zero. */
+    if (g.v[0] == 0) {
+      cond = 0;
+      for (j = 1;j < len;++j) cond |= g.v[j];
+      if (cond == 0) break;
+    }
+
+    /* Drop the top limb once it is just the sign of both f and g. */
+    fn = f.v[len - 1];
+    gn = g.v[len - 1];
+    cond = ((int64_t) len - 2) >> 63;
+    cond |= fn ^ (fn >> 63);
+    cond |= gn ^ (gn >> 63);
+    if (cond == 0) {
+      f.v[len - 2] = (int64_t) ((uint64_t) f.v[len - 2] | ((uint64_t) fn << 62));
+      g.v[len - 2] = (int64_t) ((uint64_t) g.v[len - 2] | ((uint64_t) gn << 62));
+      --len;
+    }
+  }
+
+  normalize(&d,f.v[len - 1]);
+  fe_fromsigned62(out,&d);
+}
+
+#endif
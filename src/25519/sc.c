@@ -1,5 +1,7 @@
 #include "src/25519/sc.h"
 
+#if !defined(NECTAR_25519_SC64)
+
 static uint64_t load_3(const uint8_t *in)
 {
   uint64_t result;
@@ -594,3 +596,5 @@ void sc_reduce(uint8_t *s)
   s[30] = s11 >> 9;
   s[31] = s11 >> 17;
 }
+
+#endif
@@ -3,6 +3,13 @@
 
 #include "include/nectar.h"
 
+/* Backend selection. Where the compiler has a 128-bit integer type, scalars
+ * are reduced on 64-bit limbs (see sc64.c); elsewhere on 21-bit limbs (see
+ * sc.c). Defining NECTAR_25519_SC32 forces the latter. */
+#if defined(__SIZEOF_INT128__) && !defined(NECTAR_25519_SC32)
+#define NECTAR_25519_SC64
+#endif
+
 /* Namespacing. */
 #define  sc_muladd  nectar__25519_sc_muladd
 #define  sc_reduce  nectar__25519_sc_reduce
@@ -0,0 +1,210 @@
+#include "src/25519/sc.h"
+
+/* Scalar arithmetic modulo l = 2^252 + 27742317777372353535851937790883648493
+ * on 64-bit limbs, using Barrett reduction. The results are the same as those
+ * of sc.c, and the running time does not depend on the inputs. */
+
+#if defined(NECTAR_25519_SC64)
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+/* l, and floor(2^512 / l). */
+static const uint64_t L[4] = {
+  0x5812631a5cf5d3edULL, 0x14def9dea2f79cd6ULL, 0x0000000000000000ULL,
+  0x1000000000000000ULL
+};
+
+static const uint64_t MU[5] = {
+  0xed9ce5a30a2c131bULL, 0x2106215d086329a7ULL, 0xffffffffffffffebULL,
+  0xffffffffffffffffULL, 0x000000000000000fULL
+};
+
+static uint64_t load_8(const uint8_t *in)
+{
+  uint64_t result;
+  result = (uint64_t) in[0];
+  result |= ((uint64_t) in[1]) << 8;
+  result |= ((uint64_t) in[2]) << 16;
+  result |= ((uint64_t) in[3]) << 24;
+  result |= ((uint64_t) in[4]) << 32;
+  result |= ((uint64_t) in[5]) << 40;
+  result |= ((uint64_t) in[6]) << 48;
+  result |= ((uint64_t) in[7]) << 56;
+  return result;
+}
+
+static void store_8(uint8_t *out,uint64_t in)
+{
+  int i;
+
+  for (i = 0;i < 8;++i) out[i] = (uint8_t) (in >> (8 * i));
+}
+
+/* Column-wise multiplication: (c0,c1,c2) is a 192-bit accumulator. */
+#define MULADD(a,b) do { \
+  uint128_t t_ = (uint128_t) (a) * (b); \
+  uint64_t tl_ = (uint64_t) t_; \
+  uint64_t th_ = (uint64_t) (t_ >> 64); \
+  c0 += tl_; th_ += (c0 < tl_); \
+  c1 += th_; c2 += (c1 < th_); \
+} while (0)
+
+#define EXTRACT(n) do { \
+  (n) = c0; c0 = c1; c1 = c2; c2 = 0; \
+} while (0)
+
+/*
+Input:
+  x[0]+2^64*x[1]+...+2^448*x[7]
+
+Output:
+  s[0]+256*s[1]+...+256^31*s[31] = x mod l.
+*/
+
+static void barrett(uint8_t *s,const uint64_t x[8])
+{
+  uint64_t c0 = 0, c1 = 0, c2 = 0;
+  uint64_t q0, q1, q2, q3;
+  uint64_t r[4];
+  uint64_t borrow = 0;
+  uint64_t k, mask;
+  uint128_t t, d;
+  int i;
+
+  /* q = floor(floor(x / 2^192) * mu / 2^320). The lowest three columns of
+     the product are left out, which can make q one smaller, so it is at
+     most 3 below floor(x / l). Only the lower four limbs of q are kept. */
+  MULADD(x[3],MU[3]); MULADD(x[4],MU[2]); MULADD(x[5],MU[1]); MULADD(x[6],MU[0]);
+  EXTRACT(q0);
+  MULADD(x[3],MU[4]); MULADD(x[4],MU[3]); MULADD(x[5],MU[2]); MULADD(x[6],MU[1]); MULADD(x[7],MU[0]);
+  EXTRACT(q0);
+  MULADD(x[4],MU[4]); MULADD(x[5],MU[3]); MULADD(x[6],MU[2]); MULADD(x[7],MU[1]);
+  EXTRACT(q0);
+  MULADD(x[5],MU[4]); MULADD(x[6],MU[3]); MULADD(x[7],MU[2]);
+  EXTRACT(q1);
+  MULADD(x[6],MU[4]); MULADD(x[7],MU[3]);
+  EXTRACT(q2);
+  MULADD(x[7],MU[4]);
+  EXTRACT(q3);
+  c0 = c1 = c2 = 0;
+
+  /* r = x - q * l, which is below 4 * l < 2^256, so only the lower four
+     limbs are needed. With l[2] = 0 and l[3] = 2^60, the product is mostly
+     shifts. */
+  MULADD(q0,L[0]);
+  EXTRACT(r[0]);
+  MULADD(q0,L[1]); MULADD(q1,L[0]);
+  EXTRACT(r[1]);
+  MULADD(q1,L[1]); MULADD(q2,L[0]);
+  EXTRACT(r[2]);
+  r[3] = c0 + q2 * L[1] + q3 * L[0] + (q0 << 60);
+
+  for (i = 0;i < 4;++i) {
+    d = (uint128_t) x[i] - r[i] - borrow;
+    r[i] = (uint64_t) d;
+    borrow = (uint64_t) (d >> 64) & 1;
+  }
+
+  /* Subtract k * l, where k = floor(r / 2^252) is either floor(r / l) or
+     one more, and add l back if that went below zero. */
+  k = r[3] >> 60;
+
+  t = (uint128_t) k * L[0];
+  d = (uint128_t) r[0] - (uint64_t) t;
+  r[0] = (uint64_t) d;
+  borrow = (uint64_t) (t >> 64) + ((uint64_t) (d >> 64) & 1);
+
+  t = (uint128_t) k * L[1] + borrow;
+  d = (uint128_t) r[1] - (uint64_t) t;
+  r[1] = (uint64_t) d;
+  borrow = (uint64_t) (t >> 64) + ((uint64_t) (d >> 64) & 1);
+
+  d = (uint128_t) r[2] - borrow;
+  r[2] = (uint64_t) d;
+  borrow = (uint64_t) (d >> 64) & 1;
+
+  r[3] = r[3] - (k << 60) - borrow;
+
+  mask = (uint64_t) 0 - (r[3] >> 63);
+  t = (uint128_t) r[0] + (L[0] & mask);
+  r[0] = (uint64_t) t;
+  t = (uint128_t) r[1] + (L[1] & mask) + (uint64_t) (t >> 64);
+  r[1] = (uint64_t) t;
+  t = (uint128_t) r[2] + (uint64_t) (t >> 64);
+  r[2] = (uint64_t) t;
+  r[3] = r[3] + (L[3] & mask) + (uint64_t) (t >> 64);
+
+  for (i = 0;i < 4;++i) store_8(s + 8 * i,r[i]);
+}
+
+/*
+Input:
+  s[0]+256*s[1]+...+256^63*s[63] = s
+
+Output:
+  s[0]+256*s[1]+...+256^31*s[31] = s mod l
+  where l = 2^252 + 27742317777372353535851937790883648493.
+  Overwrites s in place.
+*/
+
+void sc_reduce(uint8_t *s)
+{
+  uint64_t x[8];
+  int i;
+
+  for (i = 0;i < 8;++i) x[i] = load_8(s + 8 * i);
+
+  barrett(s,x);
+}
+
+/*
+Input:
+  a[0]+256*a[1]+...+256^31*a[31] = a
+  b[0]+256*b[1]+...+256^31*b[31] = b
+  c[0]+256*c[1]+...+256^31*c[31] = c
+
+Output:
+  s[0]+256*s[1]+...+256^31*s[31] = (ab+c) mod l
+  where l = 2^252 + 27742317777372353535851937790883648493.
+*/
+
+void sc_muladd(uint8_t *s,const uint8_t *a,const uint8_t *b,const uint8_t *c)
+{
+  uint64_t x[8];
+  uint64_t av[4];
+  uint64_t bv[4];
+  uint64_t cv[4];
+  uint64_t c0, c1, c2;
+  int i;
+
+  for (i = 0;i < 4;++i) {
+    av[i] = load_8(a + 8 * i);
+    bv[i] = load_8(b + 8 * i);
+    cv[i] = load_8(c + 8 * i);
+  }
+
+  /* ab + c < 2^512, so nothing is carried out of the top limb. */
+  c0 = cv[0]; c1 = 0; c2 = 0;
+  MULADD(av[0],bv[0]);
+  EXTRACT(x[0]);
+  c0 += cv[1]; c1 += (c0 < cv[1]);
+  MULADD(av[0],bv[1]); MULADD(av[1],bv[0]);
+  EXTRACT(x[1]);
+  c0 += cv[2]; c1 += (c0 < cv[2]);
+  MULADD(av[0],bv[2]); MULADD(av[1],bv[1]); MULADD(av[2],bv[0]);
+  EXTRACT(x[2]);
+  c0 += cv[3]; c1 += (c0 < cv[3]);
+  MULADD(av[0],bv[3]); MULADD(av[1],bv[2]); MULADD(av[2],bv[1]); MULADD(av[3],bv[0]);
+  EXTRACT(x[3]);
+  MULADD(av[1],bv[3]); MULADD(av[2],bv[2]); MULADD(av[3],bv[1]);
+  EXTRACT(x[4]);
+  MULADD(av[2],bv[3]); MULADD(av[3],bv[2]);
+  EXTRACT(x[5]);
+  MULADD(av[3],bv[3]);
+  EXTRACT(x[6]);
+  x[7] = c0;
+
+  barrett(s,x);
+}
+
+#endif
@@ -13,18 +13,75 @@
  * PERFORMANCE OF THIS SOFTWARE. */
 
 #include "include/nectar.h"
+#include "src/stats.h"
+
+
+/* Load 8 bytes from a possibly unaligned address. Only used to OR together
+ * differences, so byte order doesn't matter. */
+static uint64_t load64(const uint8_t * p) {
+    uint64_t x;
+    memcpy(&x, p, 8);
+    return x;
+}
+
+
+/* OR together the differences between two chunks of memory. The buffers are
+ * processed 32 bytes at a time using four independent accumulators, and no
+ * step depends on the contents of the buffers. */
+static uint64_t diff(const uint8_t * buf0, const uint8_t * buf1, size_t len) {
+    uint64_t r0 = 0, r1 = 0, r2 = 0, r3 = 0;
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        r0 |= load64(buf0 + i +  0) ^ load64(buf1 + i +  0);
+        r1 |= load64(buf0 + i +  8) ^ load64(buf1 + i +  8);
+        r2 |= load64(buf0 + i + 16) ^ load64(buf1 + i + 16);
+        r3 |= load64(buf0 + i + 24) ^ load64(buf1 + i + 24);
+    }
+
+    for (; i + 8 <= len; i += 8)
+        r0 |= load64(buf0 + i) ^ load64(buf1 + i);
+
+    for (; i < len; i++)
+        r1 |= (uint64_t) (buf0[i] ^ buf1[i]);
+
+    return r0 | r1 | r2 | r3;
+}
 
 
 /* Utility function which compares two equally sized chunks of memory without
  * leaking any information via timing side channels. Returns 0 if and only if
  * the two chunks are identical. */
 int nectar_bcmp(const uint8_t * buf0, const uint8_t * buf1, size_t len) {
-    uint8_t r = 0;
-    size_t i;
+    uint64_t r = diff(buf0, buf1, len);
 
-    for (i = 0; i < len; i++)
-        r |= (buf0[i] ^ buf1[i]);
+    stats_call(BCMP, len);
 
     /* Fancy bit twiddling to return either 0 or -1. */
-    return (int) ((((r - 1) >> 8) & 1) - 1);
+    r = (r | (r >> 32)) & 0xffffffff;
+    return (int) ((((r - 1) >> 32) & 1) - 1);
+}
+
+
+/* Compare `n` (at most 64) pairs of equally sized chunks of memory. Bit `i` of
+ * the result is set if and only if the `i`th pair differs. */
+uint64_t nectar_bcmp_batch(const uint8_t * const * bufs0, const uint8_t * const * bufs1,
+                           size_t len, size_t n) {
+    uint64_t mask = 0;
+    uint64_t r;
+    size_t i;
+
+    /* Pairs past the 64th can't be reported, so rather than letting them pass
+     * unchecked, report every pair as different. */
+    if (n > 64)
+        return (uint64_t) -1;
+
+    for (i = 0; i < n; i++) {
+        stats_call(BCMP, len);
+        r = diff(bufs0[i], bufs1[i], len);
+        r = (r | (r >> 32)) & 0xffffffff;
+        mask |= (1 - ((r - 1) >> 63)) << i;
+    }
+
+    return mask;
 }
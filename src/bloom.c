@@ -0,0 +1,220 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+#include "include/nectar.h"
+#include "src/endian.h"
+
+
+/* Size of the header and of each block, in bytes. */
+#define BLOCK 64
+
+/* Number of inputs hashed at a time by the batch functions. */
+#define CHUNK 16
+
+/* Maximum number of probes per input. */
+#define MAXK 32
+
+/* Header layout. All integers are stored in little-endian form. */
+#define MAGIC    "nectarbf"
+#define VERSION  1
+
+#define OFF_MAGIC    0
+#define OFF_VERSION  8
+#define OFF_K        12
+#define OFF_NBLOCKS  16
+#define OFF_CHECK    24
+
+
+/* Support macros. */
+#if defined(__GNUC__)
+#define prefetch(p, w)  __builtin_prefetch(p, w)
+#else
+#define prefetch(p, w)  ((void) 0)
+#endif
+
+
+/* Value stored in the header to detect filters loaded with the wrong seed. */
+static uint64_t check(const struct nectar_bloom * bf) {
+    return nectar_siphash_expanded(&bf->key, (const uint8_t *) MAGIC, 8);
+}
+
+
+/* Map a hash to the block it belongs in. The upper 32 bits pick the block,
+ * and only the lower 32 are used for picking bits within it. */
+static uint8_t * block(const struct nectar_bloom * bf, uint64_t hash) {
+    return bf->bits + BLOCK * (size_t) (((hash >> 32) * bf->nblocks) >> 32);
+}
+
+
+/* Set the bits for one hash. Probe positions within the 512-bit block are
+ * derived by double hashing, starting at bits 0-8 of the hash and stepping by
+ * bits 16-24, so neither overlaps the bits that picked the block. The step is
+ * odd, so all `k` positions differ as long as there are fewer than 512 of
+ * them. */
+static void set(const struct nectar_bloom * bf, uint64_t hash) {
+    uint8_t * b = block(bf, hash);
+    uint32_t p = (uint32_t) hash & 0x1ff;
+    uint32_t d = ((uint32_t) hash >> 16) | 1;
+    unsigned int i;
+
+    for (i = 0; i < bf->k; i++) {
+        b[(p >> 3) & 63] |= (uint8_t) (1 << (p & 7));
+        p += d;
+    }
+}
+
+
+/* Test the bits for one hash. */
+static int test(const struct nectar_bloom * bf, uint64_t hash) {
+    const uint8_t * b = block(bf, hash);
+    uint32_t p = (uint32_t) hash & 0x1ff;
+    uint32_t d = ((uint32_t) hash >> 16) | 1;
+    unsigned int r = 1;
+    unsigned int i;
+
+    for (i = 0; i < bf->k; i++) {
+        r &= b[(p >> 3) & 63] >> (p & 7);
+        p += d;
+    }
+
+    return (int) (r & 1) - 1;
+}
+
+
+/* Get the number of bytes needed for a filter of `nblocks` blocks. */
+size_t nectar_bloom_size(uint64_t nblocks) {
+    if (nblocks == 0 || nblocks > ((uint64_t) 1 << 32) ||
+        nblocks > (((size_t) -1) / BLOCK) - 1)
+        return 0;
+
+    return (size_t) (BLOCK * (nblocks + 1));
+}
+
+
+/* Format a chunk of memory as an empty filter. */
+int nectar_bloom_init(struct nectar_bloom * bf, void * mem, size_t len,
+                      unsigned int k, const uint8_t seed[16]) {
+    uint8_t * hdr = mem;
+    uint64_t nblocks;
+
+    nblocks = len / BLOCK - (len >= BLOCK ? 1 : 0);
+
+    if (k == 0 || k > MAXK || nectar_bloom_size(nblocks) == 0)
+        return -1;
+
+    nectar_siphash_expand(&bf->key, seed);
+
+    bf->bits = hdr + BLOCK;
+    bf->nblocks = nblocks;
+    bf->k = k;
+
+    memset(hdr, 0, BLOCK * (size_t) (nblocks + 1));
+    memcpy(hdr + OFF_MAGIC, MAGIC, 8);
+    le32enc(hdr + OFF_VERSION, VERSION);
+    le32enc(hdr + OFF_K, k);
+    le64enc(hdr + OFF_NBLOCKS, nblocks);
+    le64enc(hdr + OFF_CHECK, check(bf));
+
+    return 0;
+}
+
+
+/* Attach to a filter previously created with `nectar_bloom_init`. */
+int nectar_bloom_load(struct nectar_bloom * bf, void * mem, size_t len,
+                      const uint8_t seed[16]) {
+    uint8_t * hdr = mem;
+    uint64_t nblocks;
+    uint32_t k;
+
+    if (len < BLOCK)
+        return -1;
+    if (memcmp(hdr + OFF_MAGIC, MAGIC, 8) != 0 || le32dec(hdr + OFF_VERSION) != VERSION)
+        return -1;
+
+    k = le32dec(hdr + OFF_K);
+    nblocks = le64dec(hdr + OFF_NBLOCKS);
+
+    if (k == 0 || k > MAXK || nectar_bloom_size(nblocks) == 0 ||
+        nectar_bloom_size(nblocks) > len)
+        return -1;
+
+    nectar_siphash_expand(&bf->key, seed);
+
+    bf->bits = hdr + BLOCK;
+    bf->nblocks = nblocks;
+    bf->k = k;
+
+    if (le64dec(hdr + OFF_CHECK) != check(bf))
+        return -1;
+
+    return 0;
+}
+
+
+/* Add an element to the filter. */
+void nectar_bloom_insert(struct nectar_bloom * bf, const uint8_t * data, size_t len) {
+    set(bf, nectar_siphash_expanded(&bf->key, data, len));
+}
+
+
+/* Check whether an element might be in the filter. */
+int nectar_bloom_query(const struct nectar_bloom * bf, const uint8_t * data, size_t len) {
+    return test(bf, nectar_siphash_expanded(&bf->key, data, len));
+}
+
+
+/* Add `n` elements to the filter. Hashing a chunk of inputs at a time lets us
+ * use the batch hash function, and gives the prefetches time to complete. */
+void nectar_bloom_insert_batch(struct nectar_bloom * bf, const uint8_t * const * data,
+                               const size_t * lens, size_t n) {
+    uint64_t hash[CHUNK];
+    size_t num, i;
+
+    while (n > 0) {
+        num = (n < CHUNK ? n : CHUNK);
+
+        nectar_siphash_batch_expanded(&bf->key, data, lens, hash, num);
+        for (i = 0; i < num; i++)
+            prefetch(block(bf, hash[i]), 1);
+        for (i = 0; i < num; i++)
+            set(bf, hash[i]);
+
+        data += num;
+        lens += num;
+        n -= num;
+    }
+}
+
+
+/* Query `n` elements, storing each result in `out`. */
+void nectar_bloom_query_batch(const struct nectar_bloom * bf, const uint8_t * const * data,
+                              const size_t * lens, int * out, size_t n) {
+    uint64_t hash[CHUNK];
+    size_t num, i;
+
+    while (n > 0) {
+        num = (n < CHUNK ? n : CHUNK);
+
+        nectar_siphash_batch_expanded(&bf->key, data, lens, hash, num);
+        for (i = 0; i < num; i++)
+            prefetch(block(bf, hash[i]), 0);
+        for (i = 0; i < num; i++)
+            out[i] = test(bf, hash[i]);
+
+        data += num;
+        lens += num;
+        out += num;
+        n -= num;
+    }
+}
@@ -14,6 +14,7 @@
 
 #include "include/nectar.h"
 #include "src/endian.h"
+#include "src/stats.h"
 
 
 /* Core operations. */
@@ -55,6 +56,8 @@ static void generate(uint8_t dst[64], const uint32_t state[16]) {
     uint32_t t;
     int i;
 
+    stats_count(chacha20_blocks, 1);
+
     /* Create a working copy of the current state. */
     memcpy(x, state, 64);
 
@@ -116,6 +119,8 @@ void nectar_chacha20_xor(struct nectar_chacha20_ctx * cx, uint8_t * dst,
     uint8_t tmp[64];
     size_t off, num, i;
 
+    stats_call(CHACHA20, len);
+
     /* Generate the keystream in 64-byte pieces. */
     while (len > 0) {
         /* Update the state with the current offset (divided by 64). */
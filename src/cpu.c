@@ -0,0 +1,133 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+#include <stdlib.h>
+
+#include "include/nectar.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define HAVE_CPUID
+#endif
+
+
+/* Set once the features have been detected. */
+#define VALID  0x80000000
+
+/* Feature names accepted in the NECTAR_CPU environment variable. */
+static const struct {
+    const char * name;
+    uint32_t flag;
+} names[] = {
+    { "sse2",  NECTAR_CPU_SSE2 },
+    { "ssse3", NECTAR_CPU_SSSE3 },
+    { "avx2",  NECTAR_CPU_AVX2 },
+    { "bmi2",  NECTAR_CPU_BMI2 },
+    { "adx",   NECTAR_CPU_ADX },
+};
+
+static uint32_t features;
+static uint32_t mask = ~(uint32_t) 0;
+
+/* Threads may detect the features at the same time. They all store the same
+ * value, but the accesses are atomic to keep that well-defined. */
+#if defined(__GNUC__)
+#define load(p)      __atomic_load_n(p, __ATOMIC_RELAXED)
+#define store(p, x)  __atomic_store_n(p, x, __ATOMIC_RELAXED)
+#else
+#define load(p)      (*(p))
+#define store(p, x)  (*(p) = (x))
+#endif
+
+
+/* Query the CPU. AVX2 also needs support from the operating system, which
+ * `__builtin_cpu_supports` checks for us. ADX is not known to every compiler
+ * that has it, so it is read directly from cpuid leaf 7. */
+static uint32_t detect(void) {
+    uint32_t f = 0;
+
+#if defined(HAVE_CPUID)
+    unsigned int a, b, c, d;
+
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2"))
+        f |= NECTAR_CPU_SSE2;
+    if (__builtin_cpu_supports("ssse3"))
+        f |= NECTAR_CPU_SSSE3;
+    if (__builtin_cpu_supports("avx2"))
+        f |= NECTAR_CPU_AVX2;
+    if (__builtin_cpu_supports("bmi2"))
+        f |= NECTAR_CPU_BMI2;
+    if (__get_cpuid_max(0, NULL) >= 7) {
+        __cpuid_count(7, 0, a, b, c, d);
+        if (b & (1 << 19))
+            f |= NECTAR_CPU_ADX;
+    }
+#endif
+
+    return f;
+}
+
+
+/* Parse a comma-separated list of feature names. Unknown names are ignored. */
+static uint32_t parse(const char * s) {
+    uint32_t f = 0;
+    size_t len, i;
+
+    while (*s != '\0') {
+        len = strcspn(s, ",");
+        for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (strlen(names[i].name) == len && memcmp(s, names[i].name, len) == 0)
+                f |= names[i].flag;
+        }
+
+        s += len;
+        if (*s == ',')
+            s++;
+    }
+
+    return f;
+}
+
+
+/* Get the set of features the CPU has, less those disabled in the
+ * environment. */
+static uint32_t detected(void) {
+    const char * env;
+    uint32_t f = load(&features);
+
+    if (!(f & VALID)) {
+        f = detect();
+        if ((env = getenv("NECTAR_CPU")) != NULL)
+            f &= parse(env);
+        f |= VALID;
+        store(&features, f);
+    }
+
+    return f & ~(uint32_t) VALID;
+}
+
+
+/* Get the set of CPU features in use. */
+uint32_t nectar_cpu_features(void) {
+    return detected() & load(&mask);
+}
+
+
+/* Restrict the set of CPU features in use. Only detected features are kept,
+ * so this can never enable one the CPU lacks. */
+void nectar_cpu_mask(uint32_t m) {
+    store(&mask, detected() & m);
+}
@@ -14,13 +14,19 @@
 
 #include "include/nectar.h"
 #include "src/25519/fe.h"
+#include "src/25519/ge.h"
+#include "src/25519/ladder.h"
+#include "src/stats.h"
 
 
-/* Basepoint. */
-static const uint8_t basepoint[32] = {
-    9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-};
+/* Number of results computed at a time by the batch function. */
+#define CHUNK 32
+
+
+/* The limbs of the table in `struct nectar_curve25519_precomp` must hold
+ * exactly one `ge_precomp` for each of 8 multiples in 32 rows. */
+typedef char precomp_size_check[sizeof(((struct nectar_curve25519_precomp *) 0)->table.FE_LIMBS) ==
+                                sizeof(ge_precomp [32][8]) ? 1 : -1];
 
 
 /* Massage a 32-byte seed into a valid Curve25519 secret. */
@@ -31,21 +37,57 @@ void nectar_curve25519_clamp(uint8_t priv[32]) {
 }
 
 
-/* Multiply n with the basepoint and store the result in q. */
-void nectar_curve25519_scalarmult_base(uint8_t q[32], const uint8_t n[32]) {
-    nectar_curve25519_scalarmult(q, n, basepoint);
+/* Store the Montgomery u-coordinate of an Edwards point. With projective
+ * coordinates, u = (Z + Y) / (Z - Y), and the point at infinity gives 0. */
+static void edwards_to_u(uint8_t q[32], const ge_p3 * A) {
+    fe u, t;
+
+    fe_add(u, A->Z, A->Y);
+    fe_sub(t, A->Z, A->Y);
+    fe_invert(t, t);
+    fe_mul(u, u, t);
+    fe_tobytes(q, u);
 }
 
 
-/* Multiply p and n, storing the result in q. */
-void nectar_curve25519_scalarmult(uint8_t q[32], const uint8_t n[32], const uint8_t p[32]) {
+/* Multiply n with the basepoint and store the result in q. Rather than running
+ * the ladder, this uses the precomputed tables for the equivalent Ed25519 base
+ * point, and maps the result to Montgomery form with u = (1 + y) / (1 - y). */
+void nectar_curve25519_scalarmult_base(uint8_t q[32], const uint8_t n[32]) {
     uint8_t e[32];
+    ge_p3 A;
+
+    stats_call(CURVE25519, 32);
+
+    /* Like the ladder, ignore the topmost bit. */
+    memcpy(e, n, 32);
+    e[31] &= 127;
+
+    ge_scalarmult_base(&A, e);
+    edwards_to_u(q, &A);
+}
+
+
+/* Compute the projective coordinates of n*p with a Montgomery ladder. */
+static void ladder(fe x2, fe z2, const uint8_t n[32], const uint8_t p[32]) {
     unsigned int b, s = 0;
-    fe x1, x2, z2, x3, z3;
+    fe x1, x3, z3;
     fe t0, t1;
     int pos;
 
-    memcpy(e, n, 32);
+    stats_call(CURVE25519, 32);
+
+#if defined(NECTAR_25519_LADDER_AVX2)
+    /* Use the vectorized ladder if the CPU allows it. */
+    if (nectar_cpu_features() & NECTAR_CPU_AVX2) {
+        uint8_t x[32], z[32];
+
+        ladder_avx2(x, z, n, p);
+        fe_frombytes(x2, x);
+        fe_frombytes(z2, z);
+        return;
+    }
+#endif
 
     fe_frombytes(x1, p);
     fe_1(x2);
@@ -54,7 +96,7 @@ void nectar_curve25519_scalarmult(uint8_t q[32], const uint8_t n[32], const uint
     fe_1(z3);
 
     for (pos = 254; pos >= 0; pos--) {
-        b = (e[pos/8] >> (pos&7)) & 1;
+        b = (n[pos/8] >> (pos&7)) & 1;
 
         s ^= b;
         fe_cswap(x2, x3, s);
@@ -83,8 +125,123 @@ void nectar_curve25519_scalarmult(uint8_t q[32], const uint8_t n[32], const uint
 
     fe_cswap(x2, x3, s);
     fe_cswap(z2, z3, s);
+}
+
+
+/* Multiply p and n, storing the result in q. */
+void nectar_curve25519_scalarmult(uint8_t q[32], const uint8_t n[32], const uint8_t p[32]) {
+    fe x2, z2;
+
+    ladder(x2, z2, n, p);
 
     fe_invert(z2, z2);
     fe_mul(x2, x2, z2);
     fe_tobytes(q, x2);
 }
+
+
+/* Compute `n` shared secrets at once. The ladders are run one by one, but the
+ * final inversions are merged with Montgomery's trick, so that each chunk of
+ * results only needs a single inversion. */
+void nectar_curve25519_scalarmult_batch(uint8_t * q, const uint8_t * n, const uint8_t * p,
+                                        size_t num) {
+    fe x[CHUNK], z[CHUNK], acc[CHUNK];
+    fe one, t;
+    unsigned int zero;
+    size_t len, i;
+
+    fe_1(one);
+
+    while (num > 0) {
+        len = (num < CHUNK ? num : CHUNK);
+
+        /* Run the ladders. A point at infinity has z = 0, which would spoil
+         * the product of all z, so replace it with 1. Its x is replaced with
+         * 0 to produce the same result as `nectar_curve25519_scalarmult`. */
+        for (i = 0; i < len; i++) {
+            ladder(x[i], z[i], n + 32*i, p + 32*i);
+
+            zero = (unsigned int) (fe_isnonzero(z[i]) + 1);
+            fe_cmov(z[i], one, zero);
+            fe_0(t);
+            fe_cmov(x[i], t, zero);
+
+            if (i == 0)
+                fe_copy(acc[i], z[i]);
+            else
+                fe_mul(acc[i], acc[i-1], z[i]);
+        }
+
+        /* Invert the product, and peel off one inverse at a time. */
+        fe_invert(t, acc[len-1]);
+
+        for (i = len-1; i > 0; i--) {
+            fe_mul(acc[i], t, acc[i-1]);
+            fe_mul(t, t, z[i]);
+            fe_mul(x[i], x[i], acc[i]);
+        }
+        fe_mul(x[0], x[0], t);
+
+        for (i = 0; i < len; i++)
+            fe_tobytes(q + 32*i, x[i]);
+
+        q += 32*len;
+        n += 32*len;
+        p += 32*len;
+        num -= len;
+    }
+}
+
+
+/* Build a table of multiples of p, in the same form as the Ed25519 base point
+ * tables. The corresponding Edwards point has y = (u - 1) / (u + 1), and since
+ * the u-coordinate of a multiple does not depend on the sign of x, either of
+ * the two points with that y will do. Points on the twist, and u = -1, have no
+ * such point, so those fall back to the ladder. */
+void nectar_curve25519_precompute(struct nectar_curve25519_precomp * pre, const uint8_t p[32]) {
+    uint8_t s[32];
+    ge_p3 A;
+    fe u, y, t;
+
+    memcpy(pre->pub, p, 32);
+    pre->fallback = 1;
+
+    fe_frombytes(u, p);
+    fe_1(t);
+    fe_sub(y, u, t);
+    fe_add(t, u, t);
+
+    if (fe_isnonzero(t) == 0)
+        return;
+
+    fe_invert_vartime(t, t);
+    fe_mul(y, y, t);
+    fe_tobytes(s, y);
+
+    if (ge_frombytes_negate_vartime(&A, s) != 0)
+        return;
+
+    ge_precompute((ge_precomp (*)[8]) (void *) pre->table.FE_LIMBS, &A);
+    pre->fallback = 0;
+}
+
+
+/* Multiply the precomputed point with n, storing the result in q. */
+void nectar_curve25519_scalarmult_precomp(uint8_t q[32], const uint8_t n[32],
+                                          const struct nectar_curve25519_precomp * pre) {
+    uint8_t e[32];
+    ge_p3 A;
+
+    if (pre->fallback) {
+        nectar_curve25519_scalarmult(q, n, pre->pub);
+        return;
+    }
+
+    stats_call(CURVE25519, 32);
+
+    memcpy(e, n, 32);
+    e[31] &= 127;
+
+    ge_scalarmult_precomp(&A, (const ge_precomp (*)[8]) (const void *) pre->table.FE_LIMBS, e);
+    edwards_to_u(q, &A);
+}
@@ -15,13 +15,45 @@
 #include "include/nectar.h"
 #include "src/25519/ge.h"
 #include "src/25519/sc.h"
+#include "src/stats.h"
 
 
-/* Generate a public key from a secret key. */
-void nectar_ed25519_pubkey(uint8_t pk[32], const uint8_t sk[32]) {
+/* Number of public keys generated, and signatures checked, at a time by the
+ * batch functions. A group of signatures makes twice as many points, so that
+ * a full group is large enough for Pippenger's method. */
+#define PUBKEY_CHUNK  32
+#define VERIFY_CHUNK  64
+
+
+/* The limbs of the table in `struct nectar_ed25519_pk` must hold exactly 8
+ * `ge_cached`. */
+typedef char pk_size_check[sizeof(((struct nectar_ed25519_pk *) 0)->table.FE_LIMBS) ==
+                           sizeof(ge_cached [8]) ? 1 : -1];
+
+
+/* Prefix for Ed25519ph, as defined in RFC 8032: dom2(1, ""). */
+static const uint8_t dom2[34] = "SigEd25519 no Ed25519 collisions\001";
+
+
+/* Count a verification of `len` bytes with the given result. */
+#if defined(NECTAR_STATS)
+static int outcome(int ret, size_t len) {
+    stats_call(ED25519_VERIFY, len);
+    if (ret == 0)
+        stats_count(verify_ok, 1);
+    else
+        stats_count(verify_fail, 1);
+
+    return ret;
+}
+#else
+#define outcome(ret, len)  (ret)
+#endif
+
+
+/* Hash a secret key, and clamp the lower half into a valid scalar. */
+static void expand(uint8_t az[64], const uint8_t sk[32]) {
     struct nectar_sha512_ctx h;
-    uint8_t az[64];
-    ge_p3 A;
 
     nectar_sha512_init(&h);
     nectar_sha512_update(&h, sk, 32);
@@ -30,30 +62,23 @@ void nectar_ed25519_pubkey(uint8_t pk[32], const uint8_t sk[32]) {
     az[ 0] &= 248;
     az[31] &= 63;
     az[31] |= 64;
-
-    ge_scalarmult_base(&A, az);
-    ge_p3_tobytes(pk, &A);
 }
 
 
-/* Sign a message. */
-void nectar_ed25519_sign(uint8_t sign[64], const uint8_t *message, size_t len,
-                         const uint8_t pk[32], const uint8_t sk[32]) {
+/* Sign a message given the scalar a and the prefix, as stored in az. With ph
+ * set, the message is the SHA-512 hash of the actual message. */
+static void sign(uint8_t sig[64], const uint8_t *message, size_t len,
+                 const uint8_t pk[32], const uint8_t az[64], int ph) {
     struct nectar_sha512_ctx h;
-    uint8_t az[64];
     uint8_t nonce[64];
     uint8_t hram[64];
     ge_p3 R;
 
-    nectar_sha512_init(&h);
-    nectar_sha512_update(&h, sk, 32);
-    nectar_sha512_final(&h, az, 64);
-
-    az[ 0] &= 248;
-    az[31] &= 63;
-    az[31] |= 64;
+    stats_call(ED25519_SIGN, len);
 
     nectar_sha512_init(&h);
+    if (ph)
+        nectar_sha512_update(&h, dom2, 34);
     nectar_sha512_update(&h, az + 32, 32);
     nectar_sha512_update(&h, message, len);
     nectar_sha512_final(&h, nonce, 64);
@@ -61,34 +86,128 @@ void nectar_ed25519_sign(uint8_t sign[64], const uint8_t *message, size_t len,
     sc_reduce(nonce);
 
     ge_scalarmult_base(&R, nonce);
-    ge_p3_tobytes(sign, &R);
+    ge_p3_tobytes(sig, &R);
 
     nectar_sha512_init(&h);
-    nectar_sha512_update(&h, sign, 32);
+    if (ph)
+        nectar_sha512_update(&h, dom2, 34);
+    nectar_sha512_update(&h, sig, 32);
     nectar_sha512_update(&h, pk, 32);
     nectar_sha512_update(&h, message, len);
     nectar_sha512_final(&h, hram, 64);
 
     sc_reduce(hram);
-    sc_muladd(sign + 32, hram, az, nonce);
+    sc_muladd(sig + 32, hram, az, nonce);
 }
 
 
-/* Verify a message signature. */
-int nectar_ed25519_verify(const uint8_t sign[64], const uint8_t *message, size_t len,
-                          const uint8_t pk[32]) {
+/* Generate a public key from a secret key. */
+void nectar_ed25519_pubkey(uint8_t pk[32], const uint8_t sk[32]) {
+    uint8_t az[64];
+    ge_p3 A;
+
+    expand(az, sk);
+
+    ge_scalarmult_base(&A, az);
+    ge_p3_tobytes(pk, &A);
+}
+
+
+/* Generate `n` public keys at once. Encoding a point needs the inverse of its
+ * Z coordinate, so the inversions are merged with Montgomery's trick, and each
+ * chunk of keys only needs a single one. */
+void nectar_ed25519_pubkey_batch(uint8_t * pk, const uint8_t * sk, size_t n) {
+    uint8_t az[64];
+    ge_p3 A[PUBKEY_CHUNK];
+    fe acc[PUBKEY_CHUNK];
+    fe recip, x, y;
+    size_t len, i;
+
+    while (n > 0) {
+        len = (n < PUBKEY_CHUNK ? n : PUBKEY_CHUNK);
+
+        for (i = 0; i < len; i++) {
+            expand(az, sk + 32*i);
+            ge_scalarmult_base(&A[i], az);
+
+            if (i == 0)
+                fe_copy(acc[i], A[i].Z);
+            else
+                fe_mul(acc[i], acc[i-1], A[i].Z);
+        }
+
+        /* Invert the product, and peel off one inverse at a time. */
+        fe_invert(recip, acc[len-1]);
+
+        for (i = len; i-- > 0; ) {
+            if (i > 0) {
+                fe_mul(acc[i], recip, acc[i-1]);
+                fe_mul(recip, recip, A[i].Z);
+            } else {
+                fe_copy(acc[i], recip);
+            }
+
+            fe_mul(x, A[i].X, acc[i]);
+            fe_mul(y, A[i].Y, acc[i]);
+            fe_tobytes(pk + 32*i, y);
+            pk[32*i + 31] ^= (uint8_t) (fe_isnegative(x) << 7);
+        }
+
+        pk += 32*len;
+        sk += 32*len;
+        n -= len;
+    }
+}
+
+
+/* Expand a secret key into a signing key, which includes the public key. */
+void nectar_ed25519_expand(struct nectar_ed25519_sk * key, const uint8_t sk[32]) {
+    uint8_t az[64];
+    ge_p3 A;
+
+    expand(az, sk);
+    memcpy(key->scalar, az, 32);
+    memcpy(key->prefix, az + 32, 32);
+
+    ge_scalarmult_base(&A, az);
+    ge_p3_tobytes(key->pub, &A);
+}
+
+
+/* Sign a message. */
+void nectar_ed25519_sign(uint8_t sig[64], const uint8_t *message, size_t len,
+                         const uint8_t pk[32], const uint8_t sk[32]) {
+    uint8_t az[64];
+
+    expand(az, sk);
+    sign(sig, message, len, pk, az, 0);
+}
+
+
+/* Sign a message with an expanded key. */
+void nectar_ed25519_sign_expanded(uint8_t sig[64], const uint8_t *message, size_t len,
+                                  const struct nectar_ed25519_sk * key) {
+    uint8_t az[64];
+
+    memcpy(az, key->scalar, 32);
+    memcpy(az + 32, key->prefix, 32);
+    sign(sig, message, len, key->pub, az, 0);
+}
+
+
+/* Verify a signature given the public key and the odd multiples of its
+ * negation, Ai. With ph set, the message is a SHA-512 hash, as above. */
+static int verify(const uint8_t sign[64], const uint8_t *message, size_t len,
+                  const uint8_t pk[32], const ge_cached Ai[8], int ph) {
     struct nectar_sha512_ctx h;
     uint8_t hram[64];
     uint8_t tmp[32];
-    ge_p3 A;
     ge_p2 R;
-
-    if ((sign[63] & 0xe0) != 0)
-        return -1;
-    if (ge_frombytes_negate_vartime(&A, pk) != 0)
-        return -1;
+    fe y;
 
     nectar_sha512_init(&h);
+    if (ph)
+        nectar_sha512_update(&h, dom2, 34);
     nectar_sha512_update(&h, sign, 32);
     nectar_sha512_update(&h, pk, 32);
     nectar_sha512_update(&h, message, len);
@@ -96,8 +215,269 @@ int nectar_ed25519_verify(const uint8_t sign[64], const uint8_t *message, size_t
 
     sc_reduce(hram);
 
-    ge_double_scalarmult_vartime(&R, hram, &A, sign + 32);
-    ge_tobytes(tmp, &R);
+    ge_double_scalarmult_multiples_vartime(&R, hram, Ai, sign + 32);
+
+    /* Compare the y-coordinates in projective form first, so that a forged
+     * signature is rejected without inverting Z. The sign of x still needs
+     * the affine point, which is cheaper to get with an inversion than by
+     * decompressing the R from the signature. */
+    fe_frombytes(y, sign);
+    fe_mul(y, y, R.Z);
+    fe_sub(y, y, R.Y);
+
+    if (fe_isnonzero(y) != 0)
+        return -1;
+
+    ge_tobytes_vartime(tmp, &R);
 
     return nectar_bcmp(tmp, sign, 32);
 }
+
+
+/* Verify a message signature. */
+int nectar_ed25519_verify(const uint8_t sign[64], const uint8_t *message, size_t len,
+                          const uint8_t pk[32]) {
+    ge_cached Ai[8];
+    ge_p3 A;
+
+    if ((sign[63] & 0xe0) != 0)
+        return outcome(-1, len);
+    if (ge_frombytes_negate_vartime(&A, pk) != 0)
+        return outcome(-1, len);
+
+    ge_multiples(Ai, &A);
+
+    return outcome(verify(sign, message, len, pk, Ai, 0), len);
+}
+
+
+/* Decode a public key, and precompute what is needed to verify signatures. */
+int nectar_ed25519_decompress(struct nectar_ed25519_pk * key, const uint8_t pk[32]) {
+    ge_p3 A;
+
+    if (ge_frombytes_negate_vartime(&A, pk) != 0)
+        return -1;
+
+    memcpy(key->pub, pk, 32);
+    ge_multiples((ge_cached *) (void *) key->table.FE_LIMBS, &A);
+
+    return 0;
+}
+
+
+/* Verify a message signature with a decompressed public key. */
+int nectar_ed25519_verify_decompressed(const uint8_t sign[64], const uint8_t *message, size_t len,
+                                       const struct nectar_ed25519_pk * key) {
+    if ((sign[63] & 0xe0) != 0)
+        return outcome(-1, len);
+
+    return outcome(verify(sign, message, len, key->pub,
+                          (const ge_cached *) (const void *) key->table.FE_LIMBS, 0), len);
+}
+
+
+/* Start hashing a message for Ed25519ph. */
+void nectar_ed25519ph_init(struct nectar_ed25519ph_ctx * cx) {
+    nectar_sha512_init(&cx->h);
+}
+
+
+/* Add data to the message. */
+void nectar_ed25519ph_update(struct nectar_ed25519ph_ctx * cx, const uint8_t *data, size_t len) {
+    nectar_sha512_update(&cx->h, data, len);
+}
+
+
+/* Sign the message hashed so far. */
+void nectar_ed25519ph_sign_final(struct nectar_ed25519ph_ctx * cx, uint8_t sig[64],
+                                 const struct nectar_ed25519_sk * key) {
+    uint8_t digest[64];
+    uint8_t az[64];
+
+    nectar_sha512_final(&cx->h, digest, 64);
+
+    memcpy(az, key->scalar, 32);
+    memcpy(az + 32, key->prefix, 32);
+    sign(sig, digest, 64, key->pub, az, 1);
+}
+
+
+/* Verify a signature of the message hashed so far. */
+int nectar_ed25519ph_verify_final(struct nectar_ed25519ph_ctx * cx, const uint8_t sign[64],
+                                  const uint8_t pk[32]) {
+    uint8_t digest[64];
+    ge_cached Ai[8];
+    ge_p3 A;
+
+    nectar_sha512_final(&cx->h, digest, 64);
+
+    if ((sign[63] & 0xe0) != 0)
+        return outcome(-1, 64);
+    if (ge_frombytes_negate_vartime(&A, pk) != 0)
+        return outcome(-1, 64);
+
+    ge_multiples(Ai, &A);
+
+    return outcome(verify(sign, digest, 64, pk, Ai, 1), 64);
+}
+
+
+/* Sign a message with Ed25519ph. */
+void nectar_ed25519ph_sign(uint8_t sig[64], const uint8_t *message, size_t len,
+                           const struct nectar_ed25519_sk * key) {
+    struct nectar_ed25519ph_ctx cx;
+
+    nectar_ed25519ph_init(&cx);
+    nectar_ed25519ph_update(&cx, message, len);
+    nectar_ed25519ph_sign_final(&cx, sig, key);
+}
+
+
+/* Verify an Ed25519ph signature. */
+int nectar_ed25519ph_verify(const uint8_t sign[64], const uint8_t *message, size_t len,
+                            const uint8_t pk[32]) {
+    struct nectar_ed25519ph_ctx cx;
+
+    nectar_ed25519ph_init(&cx);
+    nectar_ed25519ph_update(&cx, message, len);
+
+    return nectar_ed25519ph_verify_final(&cx, sign, pk);
+}
+
+
+/* Decode the R part of a signature, negated. Unlike public keys, R is compared
+ * byte for byte during verification, so non-canonical encodings are rejected
+ * here as well. */
+static int decode_r(ge_p3 * R, const uint8_t r[32]) {
+    uint8_t t[32];
+    fe y;
+
+    if (ge_frombytes_negate_vartime(R, r) != 0)
+        return -1;
+
+    fe_frombytes(y, r);
+    fe_tobytes(t, y);
+
+    if (memcmp(t, r, 31) != 0 || t[31] != (r[31] & 127))
+        return -1;
+    if ((r[31] & 128) != 0 && fe_isnonzero(R->X) == 0)
+        return -1;
+
+    return 0;
+}
+
+
+/* Check up to VERIFY_CHUNK signatures at once, with the random linear combination
+ *
+ *   8 * ((sum z_i s_i) B - sum z_i R_i - sum (z_i h_i) A_i) = 0.
+ *
+ * The 128-bit coefficients z_i are derived from a hash of the whole batch, so
+ * they cannot be chosen ahead of time by whoever made the signatures. */
+static int batch(const uint8_t * sign, const uint8_t * const * data, const size_t * lens,
+                 const uint8_t * pk, size_t n) {
+    struct nectar_sha512_ctx h;
+    uint8_t hram[VERIFY_CHUNK][64];
+    uint8_t scalars[2*VERIFY_CHUNK][32];
+    uint8_t seed[64];
+    uint8_t z[64];
+    uint8_t s[32];
+    uint8_t zero[32];
+    uint8_t ctr;
+    ge_p3 points[2*VERIFY_CHUNK];
+    ge_p3 P;
+    ge_p2 R;
+    ge_p1p1 t;
+    fe d;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        if ((sign[64*i + 63] & 0xe0) != 0)
+            return -1;
+        if (ge_frombytes_negate_vartime(&points[2*i], pk + 32*i) != 0)
+            return -1;
+        if (decode_r(&points[2*i + 1], sign + 64*i) != 0)
+            return -1;
+
+        nectar_sha512_init(&h);
+        nectar_sha512_update(&h, sign + 64*i, 32);
+        nectar_sha512_update(&h, pk + 32*i, 32);
+        nectar_sha512_update(&h, data[i], lens[i]);
+        nectar_sha512_final(&h, hram[i], 64);
+
+        sc_reduce(hram[i]);
+    }
+
+    nectar_sha512_init(&h);
+    nectar_sha512_update(&h, sign, 64*n);
+    nectar_sha512_update(&h, pk, 32*n);
+    for (i = 0; i < n; i++)
+        nectar_sha512_update(&h, hram[i], 32);
+    nectar_sha512_final(&h, seed, 64);
+
+    /* Each hash of the seed gives four coefficients. The points are negated,
+     * so the combination is computed with the opposite sign. */
+    memset(zero, 0, 32);
+    memset(s, 0, 32);
+
+    for (i = 0; i < n; i++) {
+        if (i % 4 == 0) {
+            ctr = (uint8_t) (i / 4);
+            nectar_sha512_init(&h);
+            nectar_sha512_update(&h, seed, 64);
+            nectar_sha512_update(&h, &ctr, 1);
+            nectar_sha512_final(&h, z, 64);
+        }
+
+        memset(scalars[2*i + 1], 0, 32);
+        memcpy(scalars[2*i + 1], z + 16*(i % 4), 16);
+
+        sc_muladd(scalars[2*i], scalars[2*i + 1], hram[i], zero);
+        sc_muladd(s, scalars[2*i + 1], sign + 64*i + 32, s);
+    }
+
+    if (ge_multi_scalarmult_vartime(&P, s, scalars[0], points, 2*n) != 0)
+        return -1;
+
+    /* Clear any small-order component, and compare with the neutral element. */
+    ge_p3_to_p2(&R, &P);
+    ge_p2_dbl(&t, &R); ge_p1p1_to_p2(&R, &t);
+    ge_p2_dbl(&t, &R); ge_p1p1_to_p2(&R, &t);
+    ge_p2_dbl(&t, &R); ge_p1p1_to_p2(&R, &t);
+
+    fe_sub(d, R.Y, R.Z);
+
+    return (fe_isnonzero(R.X) | fe_isnonzero(d));
+}
+
+
+/* Verify `n` signatures at once. Chunks of signatures are first checked
+ * together, and only if that fails are they verified one by one, to find out
+ * which ones were invalid. */
+int nectar_ed25519_verify_batch(int * out, const uint8_t * sign, const uint8_t * const * data,
+                                const size_t * lens, const uint8_t * pk, size_t n) {
+    size_t len, i;
+    int ret = 0;
+
+    while (n > 0) {
+        len = (n < VERIFY_CHUNK ? n : VERIFY_CHUNK);
+
+        if (batch(sign, data, lens, pk, len) == 0) {
+            for (i = 0; i < len; i++)
+                out[i] = outcome(0, lens[i]);
+        } else {
+            for (i = 0; i < len; i++) {
+                out[i] = nectar_ed25519_verify(sign + 64*i, data[i], lens[i], pk + 32*i);
+                ret |= out[i];
+            }
+        }
+
+        sign += 64*len;
+        data += len;
+        lens += len;
+        pk += 32*len;
+        out += len;
+        n -= len;
+    }
+
+    return ret;
+}
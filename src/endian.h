@@ -36,6 +36,19 @@ static inline uint32_t le32dec(const uint8_t src[4]) {
 }
 
 
+/* Write a 64-bit integer to dst in little-endian form. */
+static inline void le64enc(uint8_t dst[8], uint64_t x) {
+    dst[0] = (uint8_t) (x);
+    dst[1] = (uint8_t) (x >> 8);
+    dst[2] = (uint8_t) (x >> 16);
+    dst[3] = (uint8_t) (x >> 24);
+    dst[4] = (uint8_t) (x >> 32);
+    dst[5] = (uint8_t) (x >> 40);
+    dst[6] = (uint8_t) (x >> 48);
+    dst[7] = (uint8_t) (x >> 56);
+}
+
+
 /* Read a 64-bit integer from src in little-endian form. */
 static inline uint64_t le64dec(const uint8_t src[8]) {
     return ((uint64_t) src[0])
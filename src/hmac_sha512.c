@@ -13,6 +13,7 @@
  * PERFORMANCE OF THIS SOFTWARE. */
 
 #include "include/nectar.h"
+#include "src/stats.h"
 
 
 /* Initialize an HMAC-SHA-512 context structure. */
@@ -55,6 +56,7 @@ void nectar_hmac_sha512_init(struct nectar_hmac_sha512_ctx * cx,
 /* Feed input data into an HMAC-SHA-512 context. */
 void nectar_hmac_sha512_update(struct nectar_hmac_sha512_ctx * cx,
                                const uint8_t * data, size_t len) {
+    stats_call(HMAC_SHA512, len);
     nectar_sha512_update(&cx->inner, data, len);
 }
 
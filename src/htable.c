@@ -0,0 +1,456 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+#include <stdlib.h>
+
+#include "include/nectar.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+/* Number of slots (and control bytes) per group. */
+#define GROUP 16
+
+/* Smallest number of slots in a non-empty table. */
+#define MINCAP (2 * GROUP)
+
+/* Longest key stored inline in a slot. */
+#define INLINE 16
+
+/* Number of old groups moved to the new table by each insertion or removal
+ * while the table is being resized. */
+#define STEPS 2
+
+/* Control byte values. Full slots store the lower 7 bits of their key's hash,
+ * which leaves the high bit to mark the slot as free. */
+#define EMPTY    0x80
+#define DELETED  0xfe
+
+
+/* A single slot. Keys which fit in `buf` are stored inline, and anything
+ * longer is copied to a separate allocation. */
+struct slot {
+    uint64_t hash;
+    size_t len;
+    union {
+        uint8_t buf[INLINE];
+        uint8_t * ptr;
+    } key;
+    void * value;
+};
+
+
+/* Get a pointer to a slot's key. */
+static const uint8_t * slotkey(const struct slot * s) {
+    return (s->len <= INLINE ? s->key.buf : s->key.ptr);
+}
+
+
+/* Free any memory owned by a slot. */
+static void slotfree(struct slot * s) {
+    if (s->len > INLINE)
+        free(s->key.ptr);
+}
+
+
+/* Index of the lowest set bit in a non-zero mask. */
+static unsigned int lowbit(unsigned int mask) {
+#if defined(__GNUC__)
+    return (unsigned int) __builtin_ctz(mask);
+#else
+    unsigned int i = 0;
+
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        i++;
+    }
+
+    return i;
+#endif
+}
+
+
+/* Find all control bytes in a group equal to `c`, returning a bit mask. */
+static unsigned int match(const uint8_t * ctrl, uint8_t c) {
+#if defined(__SSE2__)
+    __m128i g = _mm_loadu_si128((const __m128i *) ctrl);
+    return (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char) c)));
+#else
+    unsigned int mask = 0;
+    int i;
+
+    for (i = 0; i < GROUP; i++)
+        mask |= (unsigned int) (ctrl[i] == c) << i;
+
+    return mask;
+#endif
+}
+
+
+/* Find all free (empty or deleted) slots in a group. */
+static unsigned int matchfree(const uint8_t * ctrl) {
+#if defined(__SSE2__)
+    return (unsigned int) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) ctrl));
+#else
+    unsigned int mask = 0;
+    int i;
+
+    for (i = 0; i < GROUP; i++)
+        mask |= (unsigned int) (ctrl[i] >> 7) << i;
+
+    return mask;
+#endif
+}
+
+
+/* Allocate and clear storage for `cap` slots. Control bytes are stored at the
+ * front of the allocation, followed by the slots themselves. */
+static int alloc(uint8_t ** ctrl, struct slot ** slots, size_t cap) {
+    uint8_t * mem;
+
+    if (cap > ((size_t) -1) / (sizeof(struct slot) + 1))
+        return -1;
+
+    mem = malloc(cap * (sizeof(struct slot) + 1));
+    if (mem == NULL)
+        return -1;
+
+    memset(mem, EMPTY, cap);
+
+    *ctrl = mem;
+    *slots = (struct slot *) (mem + cap);
+
+    return 0;
+}
+
+
+/* Look up a key in one table, returning its slot or NULL. */
+static struct slot * find(uint8_t * ctrl, struct slot * slots, size_t cap,
+                          uint64_t hash, const uint8_t * key, size_t len) {
+    size_t gmask, g, i;
+    unsigned int mask;
+    struct slot * s;
+
+    if (cap == 0)
+        return NULL;
+
+    gmask = cap / GROUP - 1;
+    g = (size_t) (hash >> 7) & gmask;
+
+    /* Visit groups in triangular order, which covers every group exactly once
+     * when the number of groups is a power of two. */
+    for (i = 1; ; i++) {
+        mask = match(ctrl + g*GROUP, (uint8_t) (hash & 0x7f));
+
+        while (mask != 0) {
+            s = &slots[g*GROUP + lowbit(mask)];
+
+            if (s->hash == hash && s->len == len && memcmp(slotkey(s), key, len) == 0)
+                return s;
+
+            mask &= mask - 1;
+        }
+
+        /* A group with an empty slot has never been full, so no key could
+         * have been pushed past it. */
+        if (match(ctrl + g*GROUP, EMPTY) != 0 || i > gmask)
+            return NULL;
+
+        g = (g + i) & gmask;
+    }
+}
+
+
+/* Find a free slot for a key known not to be in the table. Returns the slot
+ * index; `*wasempty` is set if the slot was empty rather than deleted. */
+static size_t place(const uint8_t * ctrl, size_t cap, uint64_t hash, int * wasempty) {
+    size_t gmask, g, i, n;
+    unsigned int mask;
+
+    gmask = cap / GROUP - 1;
+    g = (size_t) (hash >> 7) & gmask;
+
+    for (i = 1; ; i++) {
+        mask = matchfree(ctrl + g*GROUP);
+
+        if (mask != 0) {
+            n = g*GROUP + lowbit(mask);
+            *wasempty = (ctrl[n] == EMPTY);
+            return n;
+        }
+
+        g = (g + i) & gmask;
+    }
+}
+
+
+/* Mark a slot as free. It can only be marked as empty if its group already
+ * has an empty slot; otherwise lookups might stop short of keys which were
+ * placed further along the probe sequence while the group was full. */
+static void erase(uint8_t * ctrl, size_t n, size_t * left) {
+    if (match(ctrl + (n & ~((size_t) GROUP - 1)), EMPTY) != 0) {
+        ctrl[n] = EMPTY;
+        (*left)++;
+    } else {
+        ctrl[n] = DELETED;
+    }
+}
+
+
+/* Move up to `num` groups from the old table to the current one. */
+static void migrate(struct nectar_htable * ht, size_t num) {
+    struct slot * old = ht->old_slots;
+    struct slot * cur = ht->slots;
+    unsigned int mask;
+    size_t n, i;
+    int wasempty;
+
+    while (num > 0 && ht->cursor < ht->old_cap) {
+        mask = ~matchfree(ht->old_ctrl + ht->cursor) & 0xffff;
+
+        while (mask != 0) {
+            i = ht->cursor + lowbit(mask);
+
+            n = place(ht->ctrl, ht->cap, old[i].hash, &wasempty);
+            ht->ctrl[n] = (uint8_t) (old[i].hash & 0x7f);
+            cur[n] = old[i];
+            if (wasempty)
+                ht->left--;
+
+            ht->old_ctrl[i] = DELETED;
+
+            mask &= mask - 1;
+        }
+
+        ht->cursor += GROUP;
+        num--;
+    }
+
+    /* Release the old table once everything has been moved. */
+    if (ht->cursor >= ht->old_cap) {
+        free(ht->old_ctrl);
+
+        ht->old_ctrl = NULL;
+        ht->old_slots = NULL;
+        ht->old_cap = 0;
+        ht->cursor = 0;
+    }
+}
+
+
+/* Replace the current table with a new, empty one, which entries are then
+ * gradually moved to. */
+static int resize(struct nectar_htable * ht) {
+    uint8_t * ctrl;
+    struct slot * slots;
+    size_t cap;
+
+    /* A previous resize should always have finished by now, but if it somehow
+     * hasn't, finish it. */
+    if (ht->old_cap > 0)
+        migrate(ht, (size_t) -1);
+
+    /* Double the capacity if live entries take up at least 7/16 of the table.
+     * Otherwise it is mostly clogged up with deleted slots, and a clean table
+     * of the same size will do. */
+    cap = ht->cap;
+
+    if (cap == 0)
+        cap = MINCAP;
+    else if (ht->len >= cap / 2 - cap / 16)
+        cap *= 2;
+
+    if (cap == 0 || alloc(&ctrl, &slots, cap) != 0)
+        return -1;
+
+    ht->old_ctrl = ht->ctrl;
+    ht->old_slots = ht->slots;
+    ht->old_cap = ht->cap;
+    ht->cursor = 0;
+
+    ht->ctrl = ctrl;
+    ht->slots = slots;
+    ht->cap = cap;
+    ht->left = cap - cap / 8;
+
+    return 0;
+}
+
+
+/* Reset a table to its empty state, without touching its key. */
+static void reset(struct nectar_htable * ht) {
+    ht->ctrl = NULL;
+    ht->slots = NULL;
+    ht->cap = 0;
+    ht->left = 0;
+
+    ht->old_ctrl = NULL;
+    ht->old_slots = NULL;
+    ht->old_cap = 0;
+    ht->cursor = 0;
+
+    ht->len = 0;
+}
+
+
+/* Initialize an empty hash table. */
+void nectar_htable_init(struct nectar_htable * ht, const uint8_t seed[16]) {
+    nectar_siphash_expand(&ht->key, seed);
+    reset(ht);
+}
+
+
+/* Free all memory used by a hash table. */
+void nectar_htable_free(struct nectar_htable * ht) {
+    struct slot * slots;
+    size_t i;
+
+    slots = ht->slots;
+    for (i = 0; i < ht->cap; i++)
+        if ((ht->ctrl[i] & 0x80) == 0)
+            slotfree(&slots[i]);
+
+    slots = ht->old_slots;
+    for (i = 0; i < ht->old_cap; i++)
+        if ((ht->old_ctrl[i] & 0x80) == 0)
+            slotfree(&slots[i]);
+
+    free(ht->ctrl);
+    free(ht->old_ctrl);
+
+    reset(ht);
+}
+
+
+/* Look up the value associated with a key. */
+int nectar_htable_get(const struct nectar_htable * ht, const uint8_t * key,
+                      size_t len, void ** value) {
+    struct slot * s;
+    uint64_t hash;
+
+    hash = nectar_siphash_expanded(&ht->key, key, len);
+
+    s = find(ht->ctrl, ht->slots, ht->cap, hash, key, len);
+    if (s == NULL)
+        s = find(ht->old_ctrl, ht->old_slots, ht->old_cap, hash, key, len);
+    if (s == NULL)
+        return -1;
+
+    if (value != NULL)
+        *value = s->value;
+
+    return 0;
+}
+
+
+/* Associate a value with a key, replacing any previous value. */
+int nectar_htable_put(struct nectar_htable * ht, const uint8_t * key,
+                      size_t len, void * value) {
+    struct slot * s;
+    uint64_t hash;
+    uint8_t * copy = NULL;
+    size_t n;
+    int wasempty;
+
+    hash = nectar_siphash_expanded(&ht->key, key, len);
+
+    /* Update existing entries in place, wherever they are. */
+    s = find(ht->ctrl, ht->slots, ht->cap, hash, key, len);
+    if (s == NULL)
+        s = find(ht->old_ctrl, ht->old_slots, ht->old_cap, hash, key, len);
+
+    if (s != NULL) {
+        s->value = value;
+        return 0;
+    }
+
+    /* Copy long keys before touching the table, so running out of memory
+     * leaves it unchanged. */
+    if (len > INLINE) {
+        copy = malloc(len);
+        if (copy == NULL)
+            return -1;
+        memcpy(copy, key, len);
+    }
+
+    if (ht->left == 0 && resize(ht) != 0) {
+        free(copy);
+        return -1;
+    }
+
+    /* Insert the new entry. */
+    n = place(ht->ctrl, ht->cap, hash, &wasempty);
+    s = &((struct slot *) ht->slots)[n];
+
+    ht->ctrl[n] = (uint8_t) (hash & 0x7f);
+    if (wasempty)
+        ht->left--;
+
+    s->hash = hash;
+    s->len = len;
+    s->value = value;
+
+    if (copy != NULL)
+        s->key.ptr = copy;
+    else
+        memcpy(s->key.buf, key, len);
+
+    ht->len++;
+
+    /* Make some progress on any ongoing resize. */
+    if (ht->old_cap > 0)
+        migrate(ht, STEPS);
+
+    return 0;
+}
+
+
+/* Remove a key from the table. */
+int nectar_htable_del(struct nectar_htable * ht, const uint8_t * key,
+                      size_t len, void ** value) {
+    struct slot * s;
+    uint64_t hash;
+    size_t n;
+
+    hash = nectar_siphash_expanded(&ht->key, key, len);
+
+    if ((s = find(ht->ctrl, ht->slots, ht->cap, hash, key, len)) != NULL) {
+        n = (size_t) (s - (struct slot *) ht->slots);
+        erase(ht->ctrl, n, &ht->left);
+    } else if ((s = find(ht->old_ctrl, ht->old_slots, ht->old_cap, hash, key, len)) != NULL) {
+        n = (size_t) (s - (struct slot *) ht->old_slots);
+        ht->old_ctrl[n] = DELETED;
+    } else {
+        return -1;
+    }
+
+    if (value != NULL)
+        *value = s->value;
+
+    slotfree(s);
+    ht->len--;
+
+    if (ht->old_cap > 0)
+        migrate(ht, STEPS);
+
+    return 0;
+}
+
+
+/* Get the number of entries in the table. */
+size_t nectar_htable_len(const struct nectar_htable * ht) {
+    return ht->len;
+}
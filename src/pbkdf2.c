@@ -14,6 +14,7 @@
 
 #include "include/nectar.h"
 #include "src/endian.h"
+#include "src/stats.h"
 
 
 /* Derive a stronger password. */
@@ -27,6 +28,8 @@ void nectar_pbkdf2_sha512(uint8_t * key, size_t key_len,
     uint32_t count;
     size_t num;
 
+    stats_call(PBKDF2, key_len);
+
     /* Create one initialized HMAC context that we copy for each round. */
     nectar_hmac_sha512_init(&h1, pass, pass_len);
 
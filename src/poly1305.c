@@ -14,6 +14,7 @@
 
 #include "include/nectar.h"
 #include "src/endian.h"
+#include "src/stats.h"
 
 
 /* Padding material. */
@@ -45,6 +46,8 @@ static size_t blocks(struct nectar_poly1305_ctx * cx,
     const uint32_t hibit = (final ? 0 : 1<<24);
     size_t total = len;
 
+    stats_count(poly1305_blocks, len / 16);
+
     /* Load state into local working variables. */
     r0 = cx->r[0];
     r1 = cx->r[1];
@@ -131,6 +134,8 @@ void nectar_poly1305_init(struct nectar_poly1305_ctx * cx, const uint8_t key[32]
 void nectar_poly1305_update(struct nectar_poly1305_ctx * cx, const uint8_t * data, size_t len) {
     size_t n;
 
+    stats_call(POLY1305, len);
+
     /* Ignore empty input. */
     if (len == 0)
         return;
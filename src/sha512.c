@@ -14,6 +14,7 @@
 
 #include "include/nectar.h"
 #include "src/endian.h"
+#include "src/stats.h"
 
 
 /* Round constants. */
@@ -91,6 +92,8 @@ static void transform(uint64_t state[8], const uint8_t block[128]) {
     uint64_t t0, t1;
     int i;
 
+    stats_count(sha512_blocks, 1);
+
     /* Prepare W. */
     for (i = 0; i < 16; i++)
         W[i] = be64dec(&block[8*i]);
@@ -153,6 +156,8 @@ void nectar_sha512_update(struct nectar_sha512_ctx * cx, const uint8_t * data, s
     uint64_t t0, t1;
     uint64_t rem;
 
+    stats_call(SHA512, len);
+
     /* Don't waste time if we have nothing to do. */
     if (len == 0)
         return;
@@ -14,6 +14,12 @@
 
 #include "include/nectar.h"
 #include "src/endian.h"
+#include "src/stats.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2
+#endif
 
 
 /* Support macros. */
@@ -29,28 +35,70 @@
     } while (0)
 
 
+/* Expand a 16-byte seed into the initial hash state. */
+void nectar_siphash_expand(struct nectar_siphash_key * key, const uint8_t seed[16]) {
+    uint64_t k0, k1;
+
+    k0 = le64dec(seed);
+    k1 = le64dec(seed + 8);
+
+    key->v[0] = be64dec((const uint8_t *) "somepseu") ^ k0;
+    key->v[1] = be64dec((const uint8_t *) "dorandom") ^ k1;
+    key->v[2] = be64dec((const uint8_t *) "lygenera") ^ k0;
+    key->v[3] = be64dec((const uint8_t *) "tedbytes") ^ k1;
+}
+
+
+/* Build the final message block: the `len` argument's lower bits, together
+ * with the last `len & 7` bytes of the input (which start at `data`). */
+static uint64_t lastblock(const uint8_t * data, size_t len) {
+    uint64_t m;
+
+    m = ((uint64_t) len) << 56;
+
+    switch (len & 7) {
+    case 7: m |= ((uint64_t) data[6]) << 48;
+    case 6: m |= ((uint64_t) data[5]) << 40;
+    case 5: m |= ((uint64_t) data[4]) << 32;
+    case 4: m |= ((uint64_t) data[3]) << 24;
+    case 3: m |= ((uint64_t) data[2]) << 16;
+    case 2: m |= ((uint64_t) data[1]) << 8;
+    case 1: m |= ((uint64_t) data[0]);
+    }
+
+    return m;
+}
+
+
 /* Implementation of the SipHash-2-4 hash function as defined in "SipHash: a
  * fast short-input PRF" (Aumasson, Bernstein; 2012). */
 uint64_t nectar_siphash(const uint8_t seed[16], const uint8_t * data, size_t len) {
-    uint64_t k0, k1;
+    struct nectar_siphash_key key;
+
+    nectar_siphash_expand(&key, seed);
+
+    return nectar_siphash_expanded(&key, data, len);
+}
+
+
+/* Hash `len` bytes of data using an expanded key. */
+uint64_t nectar_siphash_expanded(const struct nectar_siphash_key * key,
+                                 const uint8_t * data, size_t len) {
     uint64_t v0, v1, v2, v3;
     uint64_t m;
     const uint8_t * end;
-    size_t rem;
 
-    /* Initialize state. */
-    k0 = le64dec(seed);
-    k1 = le64dec(seed + 8);
+    stats_call(SIPHASH, len);
 
-    v0 = be64dec((const uint8_t *) "somepseu") ^ k0;
-    v1 = be64dec((const uint8_t *) "dorandom") ^ k1;
-    v2 = be64dec((const uint8_t *) "lygenera") ^ k0;
-    v3 = be64dec((const uint8_t *) "tedbytes") ^ k1;
+    /* Initialize state. */
+    v0 = key->v[0];
+    v1 = key->v[1];
+    v2 = key->v[2];
+    v3 = key->v[3];
 
     /* Split the input into 64-bit blocks and mix them into the hash state,
      * one by one. */
-    rem = len & 7;
-    end = data + (len - rem);
+    end = data + (len - (len & 7));
 
     while (data < end) {
         m = le64dec(data);
@@ -65,17 +113,7 @@ uint64_t nectar_siphash(const uint8_t seed[16], const uint8_t * data, size_t len
 
     /* Mix in the `len` argument's lower bits, together with any bytes
      * remaining of the input. */
-    m = ((uint64_t) len) << 56;
-
-    switch (rem) {
-    case 7: m |= ((uint64_t) data[6]) << 48;
-    case 6: m |= ((uint64_t) data[5]) << 40;
-    case 5: m |= ((uint64_t) data[4]) << 32;
-    case 4: m |= ((uint64_t) data[3]) << 24;
-    case 3: m |= ((uint64_t) data[2]) << 16;
-    case 2: m |= ((uint64_t) data[1]) << 8;
-    case 1: m |= ((uint64_t) data[0]);
-    }
+    m = lastblock(data, len);
 
     v3 ^= m;
     rnd(v0, v1, v2, v3);
@@ -94,3 +132,162 @@ uint64_t nectar_siphash(const uint8_t seed[16], const uint8_t * data, size_t len
 
     return le64dec((const uint8_t *) &m);
 }
+
+
+#if defined(HAVE_AVX2)
+/* AVX2 versions of the support macros, operating on four states at once. */
+#define add4(x, y)  _mm256_add_epi64(x, y)
+#define xor4(x, y)  _mm256_xor_si256(x, y)
+
+#define rotl4(x, n)                                                            \
+    _mm256_or_si256(_mm256_slli_epi64(x, n), _mm256_srli_epi64(x, 64 - (n)))
+
+#define rotl4_16(x)                                                            \
+    _mm256_shuffle_epi8(x, _mm256_setr_epi8(6, 7, 0, 1, 2, 3, 4, 5,            \
+                                            14, 15, 8, 9, 10, 11, 12, 13,      \
+                                            6, 7, 0, 1, 2, 3, 4, 5,            \
+                                            14, 15, 8, 9, 10, 11, 12, 13))
+
+#define rotl4_32(x)                                                            \
+    _mm256_shuffle_epi32(x, 0xb1)
+
+#define rnd4(v0, v1, v2, v3)                                                   \
+    do {                                                                       \
+        v0 = add4(v0, v1);  v1 = rotl4(v1, 13);  v1 = xor4(v1, v0);            \
+        v0 = rotl4_32(v0);                                                     \
+        v2 = add4(v2, v3);  v3 = rotl4_16(v3);   v3 = xor4(v3, v2);            \
+        v0 = add4(v0, v3);  v3 = rotl4(v3, 21);  v3 = xor4(v3, v0);            \
+        v2 = add4(v2, v1);  v1 = rotl4(v1, 17);  v1 = xor4(v1, v2);            \
+        v2 = rotl4_32(v2);                                                     \
+    } while (0)
+
+
+/* Hash exactly four inputs in lockstep, one per 64-bit lane. */
+__attribute__((target("avx2")))
+static void lanes(uint64_t out[4], const struct nectar_siphash_key * key,
+                  const uint8_t * const * data, const size_t * lens) {
+    __m256i v0, v1, v2, v3;
+    __m256i w0, w1, w2, w3;
+    __m256i m, mask;
+    uint64_t t[4];
+    int64_t f[4];
+    size_t nb, num, i, j;
+
+    /* Count the full blocks shared by all inputs, and the total number of
+     * blocks (including the final one) in the longest input. */
+    nb = lens[0] >> 3;
+    num = nb + 1;
+
+    for (j = 1; j < 4; j++) {
+        if ((lens[j] >> 3) < nb)
+            nb = lens[j] >> 3;
+        if ((lens[j] >> 3) + 1 > num)
+            num = (lens[j] >> 3) + 1;
+    }
+
+    v0 = _mm256_set1_epi64x((int64_t) key->v[0]);
+    v1 = _mm256_set1_epi64x((int64_t) key->v[1]);
+    v2 = _mm256_set1_epi64x((int64_t) key->v[2]);
+    v3 = _mm256_set1_epi64x((int64_t) key->v[3]);
+
+    /* Mix in the blocks all inputs have in common. */
+    for (i = 0; i < nb; i++) {
+        m = _mm256_setr_epi64x((int64_t) le64dec(data[0] + 8*i),
+                               (int64_t) le64dec(data[1] + 8*i),
+                               (int64_t) le64dec(data[2] + 8*i),
+                               (int64_t) le64dec(data[3] + 8*i));
+
+        v3 = xor4(v3, m);
+        rnd4(v0, v1, v2, v3);
+        rnd4(v0, v1, v2, v3);
+        v0 = xor4(v0, m);
+    }
+
+    /* Then the rest, including every input's final block. Lanes which have
+     * already consumed all of their input are masked out, and are given a
+     * zero block rather than reading past the end of their input. With
+     * equally long inputs this loop only runs once. */
+    for (; i < num; i++) {
+        for (j = 0; j < 4; j++) {
+            if (i < (lens[j] >> 3))
+                t[j] = le64dec(data[j] + 8*i);
+            else if (i == (lens[j] >> 3))
+                t[j] = lastblock(data[j] + 8*i, lens[j]);
+            else
+                t[j] = 0;
+
+            f[j] = (i <= (lens[j] >> 3) ? -1 : 0);
+        }
+
+        m = _mm256_setr_epi64x((int64_t) t[0], (int64_t) t[1],
+                               (int64_t) t[2], (int64_t) t[3]);
+        mask = _mm256_setr_epi64x(f[0], f[1], f[2], f[3]);
+
+        w0 = v0;
+        w1 = v1;
+        w2 = v2;
+        w3 = xor4(v3, m);
+        rnd4(w0, w1, w2, w3);
+        rnd4(w0, w1, w2, w3);
+        w0 = xor4(w0, m);
+
+        v0 = _mm256_blendv_epi8(v0, w0, mask);
+        v1 = _mm256_blendv_epi8(v1, w1, mask);
+        v2 = _mm256_blendv_epi8(v2, w2, mask);
+        v3 = _mm256_blendv_epi8(v3, w3, mask);
+    }
+
+    /* Finalize all four hashes. */
+    v2 = xor4(v2, _mm256_set1_epi64x(0xff));
+    rnd4(v0, v1, v2, v3);
+    rnd4(v0, v1, v2, v3);
+    rnd4(v0, v1, v2, v3);
+    rnd4(v0, v1, v2, v3);
+
+    m = xor4(xor4(v0, v1), xor4(v2, v3));
+    _mm256_storeu_si256((__m256i *) t, m);
+
+    for (j = 0; j < 4; j++)
+        out[j] = le64dec((const uint8_t *) &t[j]);
+}
+#endif
+
+
+/* Hash `n` inputs using the same seed. */
+void nectar_siphash_batch(const uint8_t seed[16], const uint8_t * const * data,
+                          const size_t * lens, uint64_t * out, size_t n) {
+    struct nectar_siphash_key key;
+
+    nectar_siphash_expand(&key, seed);
+    nectar_siphash_batch_expanded(&key, data, lens, out, n);
+}
+
+
+/* Hash `n` inputs using an expanded key. */
+void nectar_siphash_batch_expanded(const struct nectar_siphash_key * key,
+                                   const uint8_t * const * data,
+                                   const size_t * lens, uint64_t * out, size_t n) {
+#if defined(HAVE_AVX2)
+    /* Process as many groups of four as possible, if the CPU allows it. */
+    if (nectar_cpu_features() & NECTAR_CPU_AVX2) {
+        while (n >= 4) {
+            stats_call(SIPHASH, lens[0]);
+            stats_call(SIPHASH, lens[1]);
+            stats_call(SIPHASH, lens[2]);
+            stats_call(SIPHASH, lens[3]);
+            lanes(out, key, data, lens);
+
+            data += 4;
+            lens += 4;
+            out += 4;
+            n -= 4;
+        }
+    }
+#endif
+
+    /* Hash the remaining inputs one by one. */
+    while (n > 0) {
+        *out++ = nectar_siphash_expanded(key, *data++, *lens++);
+        n--;
+    }
+}
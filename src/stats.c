@@ -0,0 +1,135 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+#if defined(NECTAR_STATS)
+#define _POSIX_C_SOURCE 200112L
+#include <pthread.h>
+#include <stdlib.h>
+#endif
+
+#include "src/stats.h"
+
+
+#if defined(NECTAR_STATS)
+
+/* Size of a cache line, in bytes. */
+#define LINE 64
+
+/* A thread's counters, padded to whole cache lines. Blocks are never freed:
+ * when a thread exits, its block is taken over by the next thread to start
+ * counting, so the counts are kept and the number of blocks stays at the
+ * largest number of threads that ever counted at once. Threads that could not
+ * allocate a block, and threads still counting after giving theirs back while
+ * exiting, use shared counters instead. */
+struct block {
+    struct nectar_stats stats;
+    struct block * next;
+    int used;
+} __attribute__((aligned(LINE)));
+
+/* All blocks, and the shared counters. */
+static struct block * head;
+struct nectar_stats nectar__stats_shared;
+
+static pthread_key_t key;
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+__thread struct nectar_stats * nectar__stats_local;
+
+
+/* Hand back the block of an exiting thread. The thread may still count from
+ * other destructors, which from now on goes to the shared counters. */
+static void release(void * b) {
+    nectar__stats_local = &nectar__stats_shared;
+    __atomic_store_n(&((struct block *) b)->used, 0, __ATOMIC_RELEASE);
+}
+
+static void setup(void) {
+    if (pthread_key_create(&key, release) != 0)
+        abort();
+}
+
+
+/* Find a block for the calling thread, on its first count. */
+struct nectar_stats * nectar__stats_attach(void) {
+    struct block * b;
+    void * mem;
+    int unused;
+
+    pthread_once(&once, setup);
+
+    /* Take over the block of a thread that has exited, if there is one. */
+    for (b = __atomic_load_n(&head, __ATOMIC_ACQUIRE); b != NULL; b = b->next) {
+        unused = 0;
+        if (__atomic_compare_exchange_n(&b->used, &unused, 1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+    }
+
+    /* Otherwise add a new one to the list. */
+    if (b == NULL) {
+        if (posix_memalign(&mem, LINE, sizeof(struct block)) != 0) {
+            nectar__stats_local = &nectar__stats_shared;
+            return &nectar__stats_shared;
+        }
+
+        b = mem;
+        memset(b, 0, sizeof(*b));
+        b->used = 1;
+        b->next = __atomic_load_n(&head, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&head, &b->next, b, 0,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            ;
+    }
+
+    pthread_setspecific(key, b);
+    nectar__stats_local = &b->stats;
+
+    return &b->stats;
+}
+
+
+/* Add the counters of one block to `st`. The structure holds nothing but
+ * 64-bit counters, so it can be treated as an array of them. */
+static void add(struct nectar_stats * st, struct nectar_stats * from) {
+    uint64_t * dst = (uint64_t *) st;
+    uint64_t * src = (uint64_t *) from;
+    size_t i;
+
+    for (i = 0; i < sizeof(*st) / sizeof(uint64_t); i++)
+        dst[i] += __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+}
+
+#endif
+
+
+/* Add up the counters of all threads. */
+int nectar_stats_snapshot(struct nectar_stats * st) {
+#if defined(NECTAR_STATS)
+    struct block * b;
+
+    memset(st, 0, sizeof(*st));
+
+    for (b = __atomic_load_n(&head, __ATOMIC_ACQUIRE); b != NULL; b = b->next)
+        add(st, &b->stats);
+    add(st, &nectar__stats_shared);
+
+    return 0;
+#else
+    memset(st, 0, sizeof(*st));
+
+    return -1;
+#endif
+}
@@ -0,0 +1,81 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+#ifndef LIBNECTAR_STATS_H
+#define LIBNECTAR_STATS_H
+
+#include "include/nectar.h"
+
+
+/* Counting hooks, which compile to nothing unless NECTAR_STATS is defined.
+ * `stats_call` records a call of a primitive on `len` bytes, and
+ * `stats_count` adds to one of the other counters. */
+#if defined(NECTAR_STATS)
+
+#if !defined(__GNUC__)
+#error "NECTAR_STATS needs GCC or Clang"
+#endif
+
+extern __thread struct nectar_stats * nectar__stats_local;
+extern struct nectar_stats nectar__stats_shared;
+struct nectar_stats * nectar__stats_attach(void);
+
+
+/* Get the counters of the calling thread. */
+static inline struct nectar_stats * stats_get(void) {
+    struct nectar_stats * st = nectar__stats_local;
+
+    return st != NULL ? st : nectar__stats_attach();
+}
+
+
+/* Add to a counter in `st`. Only the owning thread writes its counters, but
+ * any thread may read them, so the accesses are atomic. They are relaxed, and
+ * compile to plain loads and stores. The shared counters of threads that have
+ * no block of their own are written by several threads, so they need a real
+ * atomic addition. */
+static inline void stats_add(struct nectar_stats * st, uint64_t * c, uint64_t n) {
+    if (st == &nectar__stats_shared)
+        __atomic_fetch_add(c, n, __ATOMIC_RELAXED);
+    else
+        __atomic_store_n(c, __atomic_load_n(c, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+
+static inline void stats_record(int prim, size_t len) {
+    struct nectar_stats * st = stats_get();
+    struct nectar_stats_primitive * p = &st->primitive[prim];
+    int bucket = (len == 0 ? 0 : 64 - __builtin_clzll((unsigned long long) len));
+
+    stats_add(st, &p->calls, 1);
+    stats_add(st, &p->bytes, (uint64_t) len);
+    stats_add(st, &p->sizes[bucket], 1);
+}
+
+#define stats_call(prim, len)    stats_record(NECTAR_STATS_##prim, len)
+#define stats_count(field, n)                                               \
+    do {                                                                    \
+        struct nectar_stats * st_ = stats_get();                            \
+        stats_add(st_, &st_->field, (uint64_t) (n));                        \
+    } while (0)
+
+#else
+
+#define stats_call(prim, len)    ((void) 0)
+#define stats_count(field, n)    ((void) 0)
+
+#endif
+
+#endif
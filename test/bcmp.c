@@ -0,0 +1,74 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Checks the constant time comparison functions by flipping each byte of
+ * otherwise equal buffers, for lengths covering every loop in the code, and
+ * that the batch function refuses more pairs than its result can hold. */
+#include <stdint.h>
+#include <string.h>
+
+#include "include/nectar.h"
+#include "test/test.h"
+
+#define MAXLEN 80
+#define PAIRS  64
+
+static uint8_t a[PAIRS][MAXLEN], b[PAIRS][MAXLEN];
+static const uint8_t * pa[PAIRS + 1], * pb[PAIRS + 1];
+
+
+int main(void) {
+    uint64_t expect;
+    size_t len, pos, i;
+    unsigned int bit;
+
+    for (i = 0; i < PAIRS; i++) {
+        fill(a[i], MAXLEN, (uint32_t) i);
+        memcpy(b[i], a[i], MAXLEN);
+        pa[i] = a[i];
+        pb[i] = b[i];
+    }
+    pa[PAIRS] = a[0];
+    pb[PAIRS] = b[0];
+
+    for (len = 0; len <= MAXLEN; len++) {
+        check(nectar_bcmp(a[0], b[0], len) == 0);
+        check(nectar_bcmp_batch(pa, pb, len, PAIRS) == 0);
+        check(nectar_bcmp_batch(pa, pb, len, 0) == 0);
+
+        /* One differing byte at every position, in every bit, and in a
+         * different pair each time. */
+        for (pos = 0; pos < len; pos++) {
+            for (bit = 0; bit < 8; bit++) {
+                i = (pos*8 + bit) % PAIRS;
+                b[i][pos] ^= (uint8_t) (1 << bit);
+
+                check(nectar_bcmp(a[i], b[i], len) == -1);
+                check(nectar_bcmp(a[i], b[i], pos) == 0);
+                expect = (uint64_t) 1 << i;
+                check(nectar_bcmp_batch(pa, pb, len, PAIRS) == expect);
+                check(nectar_bcmp_batch(pa, pb, len, i) == 0);
+                check(nectar_bcmp_batch(pa, pb, pos, PAIRS) == 0);
+
+                b[i][pos] ^= (uint8_t) (1 << bit);
+            }
+        }
+    }
+
+    /* Too many pairs, all of them equal. */
+    check(nectar_bcmp_batch(pa, pb, MAXLEN, PAIRS + 1) == (uint64_t) -1);
+
+    return 0;
+}
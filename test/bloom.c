@@ -0,0 +1,97 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Checks that the Bloom filter has no false negatives, whether elements are
+ * inserted and queried one at a time or in batches, that the batch and single
+ * queries agree on elements which were never inserted, and that a filter can
+ * only be loaded again with the seed it was created with. */
+#include <stdint.h>
+#include <string.h>
+
+#include "include/nectar.h"
+#include "test/test.h"
+
+#define N       5000
+#define NBLOCKS 64
+#define K       7
+
+static const uint8_t seed[16] = {
+    0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe,
+    0xef, 0xcd, 0xab, 0x89, 0x67, 0x45, 0x23, 0x01
+};
+
+static uint8_t elems[2*N][24];
+static const uint8_t * ptrs[2*N];
+static size_t lens[2*N];
+static int out[2*N];
+
+
+static void run(void) {
+    static uint8_t mem[64 * (NBLOCKS + 1)];
+    struct nectar_bloom bf, other;
+    uint8_t wrong[16];
+    size_t i;
+
+    check(nectar_bloom_size(NBLOCKS) == sizeof(mem));
+    check(nectar_bloom_init(&bf, mem, sizeof(mem), K, seed) == 0);
+
+    /* The first half goes in one at a time, the second half in batches of
+     * odd sizes. */
+    for (i = 0; i < N/2; i++)
+        nectar_bloom_insert(&bf, ptrs[i], lens[i]);
+    for (i = N/2; i < N; i += 37)
+        nectar_bloom_insert_batch(&bf, ptrs + i, lens + i, (N - i < 37 ? N - i : 37));
+
+    for (i = 0; i < N; i++)
+        check(nectar_bloom_query(&bf, ptrs[i], lens[i]) == 0);
+
+    nectar_bloom_query_batch(&bf, ptrs, lens, out, 2*N);
+    for (i = 0; i < N; i++)
+        check(out[i] == 0);
+    for (i = N; i < 2*N; i++)
+        check(out[i] == nectar_bloom_query(&bf, ptrs[i], lens[i]));
+
+    /* The filter is heavily loaded, but some elements must still be absent. */
+    for (i = N; i < 2*N && out[i] == 0; i++)
+        ;
+    check(i < 2*N);
+
+    /* Reload the filter from its memory. */
+    check(nectar_bloom_load(&other, mem, sizeof(mem), seed) == 0);
+    for (i = 0; i < N; i++)
+        check(nectar_bloom_query(&other, ptrs[i], lens[i]) == 0);
+    memcpy(wrong, seed, 16);
+    wrong[15] ^= 1;
+    check(nectar_bloom_load(&other, mem, sizeof(mem), wrong) == -1);
+    check(nectar_bloom_load(&other, mem, sizeof(mem) - 1, seed) == -1);
+}
+
+
+int main(void) {
+    size_t i;
+
+    for (i = 0; i < 2*N; i++) {
+        lens[i] = 4 + i % 21;
+        memcpy(elems[i], &i, 4);
+        fill(elems[i] + 4, lens[i] - 4, (uint32_t) i);
+        ptrs[i] = elems[i];
+    }
+
+    run();
+    nectar_cpu_mask(0);
+    run();
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Checks that NECTAR_CPU and `nectar_cpu_mask` only ever restrict the
+ * detected CPU features. The environment is read once per process, so each
+ * case runs in a child process, which reports the features in its exit
+ * status. */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "include/nectar.h"
+#include "test/test.h"
+
+#define ALL  (NECTAR_CPU_SSE2 | NECTAR_CPU_SSSE3 | NECTAR_CPU_AVX2 | \
+              NECTAR_CPU_BMI2 | NECTAR_CPU_ADX)
+
+
+/* Get the features in use with NECTAR_CPU set to env (or unset, if NULL)
+ * and the given mask applied. */
+static uint32_t features(const char * env, uint32_t mask) {
+    pid_t pid;
+    int status;
+
+    pid = fork();
+    check(pid >= 0);
+
+    if (pid == 0) {
+        if (env == NULL)
+            unsetenv("NECTAR_CPU");
+        else
+            setenv("NECTAR_CPU", env, 1);
+
+        nectar_cpu_mask(mask);
+        _exit((int) nectar_cpu_features());
+    }
+
+    check(waitpid(pid, &status, 0) == pid);
+    check(WIFEXITED(status));
+
+    return (uint32_t) WEXITSTATUS(status);
+}
+
+
+int main(void) {
+    uint32_t all;
+
+    unsetenv("NECTAR_CPU");
+    all = features(NULL, ~(uint32_t) 0);
+
+    check((all & ~(uint32_t) ALL) == 0);
+
+    /* Unknown and empty names are ignored, and names must match exactly. */
+    check(features("bogus,avx2,,xyz", ~(uint32_t) 0) == (all & NECTAR_CPU_AVX2));
+    check(features("sse2,ssse3", ~(uint32_t) 0) == (all & (NECTAR_CPU_SSE2 | NECTAR_CPU_SSSE3)));
+    check(features("sse2,ssse3,avx2,bmi2,adx,sse4", ~(uint32_t) 0) == all);
+    check(features("SSE2,avx,avx2x,sse2 ", ~(uint32_t) 0) == 0);
+    check(features("none", ~(uint32_t) 0) == 0);
+    check(features("", ~(uint32_t) 0) == 0);
+    check(features(",,,", ~(uint32_t) 0) == 0);
+
+    /* The mask is intersected with what was detected, and with NECTAR_CPU,
+     * so it can never add a feature. */
+    check(features(NULL, 0) == 0);
+    check(features(NULL, NECTAR_CPU_AVX2) == (all & NECTAR_CPU_AVX2));
+    check(features(NULL, ALL | 0x80000000) == all);
+    check(features("sse2", ALL) == (all & NECTAR_CPU_SSE2));
+    check(features("sse2", NECTAR_CPU_AVX2) == 0);
+
+    /* The same holds within this process. */
+    nectar_cpu_mask(~(uint32_t) 0);
+    check(nectar_cpu_features() == all);
+    nectar_cpu_mask(NECTAR_CPU_SSE2 | NECTAR_CPU_ADX);
+    check(nectar_cpu_features() == (all & (NECTAR_CPU_SSE2 | NECTAR_CPU_ADX)));
+    nectar_cpu_mask(0);
+    check(nectar_cpu_features() == 0);
+    nectar_cpu_mask(~(uint32_t) 0);
+    check(nectar_cpu_features() == all);
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Checks X25519 against the test vectors of RFC 7748, sections 5.2 and 6.1,
+ * and the batch function against single calls. Run `make test` both with the
+ * default field arithmetic and with NECTAR_25519_FE32 to cover both
+ * backends. */
+#include <stdint.h>
+#include <string.h>
+
+#include "include/nectar.h"
+#include "test/test.h"
+
+/* Largest batch tested, which spans several of the library's chunks. */
+#define MAXBATCH 70
+
+
+static const struct {
+    const char * scalar;
+    const char * u;
+    const char * out;
+} vectors[] = {
+    { "a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18506a2244ba449ac4",
+      "e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a903a6d0ab1c4c",
+      "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552" },
+    { "4b66e9d4d1b4673c5ad22691957d6af5c11b6421e0ea01d42ca4169e7918ba0d",
+      "e5210f12786811d3f4b7959d0538ae2c31dbe7106fc03c3efc4cd549c715a493",
+      "95cbde9476e8907d7aade45cb4b873f88b595a68799fa152e6f8f7647aac7957" },
+};
+
+
+/* The function X25519 of the RFC, which clamps the scalar itself. */
+static void x25519(uint8_t out[32], const uint8_t scalar[32], const uint8_t u[32]) {
+    uint8_t k[32];
+
+    memcpy(k, scalar, 32);
+    nectar_curve25519_clamp(k);
+    nectar_curve25519_scalarmult(out, k, u);
+}
+
+
+static void run(void) {
+    uint8_t scalar[32], u[32], out[32], expect[32], k[32], t[32];
+    uint8_t alice[32], bob[32], pub[32];
+    size_t i;
+
+    for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        unhex(scalar, vectors[i].scalar);
+        unhex(u, vectors[i].u);
+        unhex(expect, vectors[i].out);
+        x25519(out, scalar, u);
+        check(memcmp(out, expect, 32) == 0);
+    }
+
+    /* Iterating k, u = X25519(k, u), k, starting from the base point. */
+    memset(k, 0, 32);
+    k[0] = 9;
+    memcpy(u, k, 32);
+    for (i = 1; i <= 1000; i++) {
+        x25519(t, k, u);
+        memcpy(u, k, 32);
+        memcpy(k, t, 32);
+
+        if (i == 1) {
+            unhex(expect, "422c8e7a6227d7bca1350b3e2bb7279f7897b87bb6854b783c60e80311ae3079");
+            check(memcmp(k, expect, 32) == 0);
+        }
+    }
+    unhex(expect, "684cf59ba83309552800ef566f2f4d3c1c3887c49360e3875f2eb94d99532c51");
+    check(memcmp(k, expect, 32) == 0);
+
+    /* Diffie-Hellman. */
+    unhex(alice, "77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a");
+    unhex(bob, "5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb");
+    nectar_curve25519_clamp(alice);
+    nectar_curve25519_clamp(bob);
+
+    nectar_curve25519_scalarmult_base(pub, alice);
+    unhex(expect, "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a");
+    check(memcmp(pub, expect, 32) == 0);
+    nectar_curve25519_scalarmult_base(pub, bob);
+    unhex(expect, "de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f");
+    check(memcmp(pub, expect, 32) == 0);
+
+    unhex(expect, "4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742");
+    nectar_curve25519_scalarmult(out, alice, pub);
+    check(memcmp(out, expect, 32) == 0);
+    unhex(u, "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a");
+    nectar_curve25519_scalarmult(out, bob, u);
+    check(memcmp(out, expect, 32) == 0);
+}
+
+
+/* Batches of every size around the chunk boundaries, and scalar
+ * multiplications with a precomputed table, must give the same results as
+ * single calls. */
+static void batch(void) {
+    static const size_t sizes[] = { 0, 1, 2, 31, 32, 33, 64, MAXBATCH };
+    static uint8_t priv[MAXBATCH][32], pub[MAXBATCH][32];
+    static uint8_t out[MAXBATCH + 1][32], expect[MAXBATCH][32];
+    static struct nectar_curve25519_precomp pre;
+    size_t i, j, n;
+
+    for (i = 0; i < MAXBATCH; i++) {
+        fill(priv[i], 32, (uint32_t) i);
+        nectar_curve25519_clamp(priv[i]);
+        fill(pub[i], 32, (uint32_t) (1000 + i));
+        pub[i][31] &= 127;
+    }
+
+    /* A point of small order gives zero, which must not spoil the shared
+     * inversion for the rest of the batch. */
+    memset(pub[5], 0, 32);
+
+    for (i = 0; i < MAXBATCH; i++)
+        nectar_curve25519_scalarmult(expect[i], priv[i], pub[i]);
+
+    /* The precomputed table for one key gives the same results too. */
+    nectar_curve25519_precompute(&pre, pub[0]);
+    for (i = 0; i < MAXBATCH; i++) {
+        nectar_curve25519_scalarmult(out[0], priv[i], pub[0]);
+        nectar_curve25519_scalarmult_precomp(out[1], priv[i], &pre);
+        check(memcmp(out[0], out[1], 32) == 0);
+    }
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        n = sizes[i];
+        memset(out, 0xaa, sizeof(out));
+        nectar_curve25519_scalarmult_batch(out[0], priv[0], pub[0], n);
+        for (j = 0; j < n; j++)
+            check(memcmp(out[j], expect[j], 32) == 0);
+        for (j = 0; j < 32; j++)
+            check(out[n][j] == 0xaa);
+    }
+}
+
+
+int main(void) {
+    run();
+    batch();
+    nectar_cpu_mask(0);
+    run();
+    batch();
+
+    return 0;
+}
@@ -0,0 +1,299 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Checks Ed25519 and Ed25519ph against the test vectors of RFC 8032, and the
+ * batch and expanded key functions against single calls. Run `make test`
+ * both with the default field arithmetic and with NECTAR_25519_FE32 to cover
+ * both backends. */
+#include <stdint.h>
+#include <string.h>
+
+#include "include/nectar.h"
+#include "test/test.h"
+
+
+static const struct {
+    const char * secret;
+    const char * pub;
+    const char * msg;
+    const char * sig;
+} vectors[] = {
+    { "9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+      "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a",
+      "",
+      "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e06522490155"
+      "5fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b" },
+    { "4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+      "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c",
+      "72",
+      "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da"
+      "085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00" },
+    { "c5aa8df43f9f837bedb7442f31dcb7b166d38535076f094b85ce3a2e0b4458f7",
+      "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025",
+      "af82",
+      "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac"
+      "18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a" },
+    { "833fe62409237b9d62ec77587520911e9a759cec1d19755b7da901b96dca3d42",
+      "ec172b93ad5e563bf4932c70e1245034c35467ef2efd4d64ebf819683467e2bf",
+      "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+      "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f",
+      "dc2a4459e7369633a52b1bf277839a00201009a3efbf3ecb69bea2186c26b589"
+      "09351fc9ac90b3ecfdfbc7c66431e0303dca179c138ac17ad9bef1177331a704" },
+};
+
+#define NVECTORS (sizeof(vectors) / sizeof(vectors[0]))
+
+/* Enough signatures for more than two groups of 64, and for Pippenger's
+ * method within a group. */
+#define MAXBATCH 130
+
+/* The group order, little endian. */
+static const uint8_t order[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+    0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10,
+};
+
+
+static void rfc8032(void) {
+    uint8_t secret[32], pub[32], expect_pub[32], sig[64], expect_sig[64], msg[64];
+    struct nectar_ed25519_pk pk;
+    size_t i, len;
+
+    for (i = 0; i < NVECTORS; i++) {
+        unhex(secret, vectors[i].secret);
+        unhex(expect_pub, vectors[i].pub);
+        unhex(expect_sig, vectors[i].sig);
+        len = unhex(msg, vectors[i].msg);
+
+        nectar_ed25519_pubkey(pub, secret);
+        check(memcmp(pub, expect_pub, 32) == 0);
+
+        nectar_ed25519_sign(sig, msg, len, pub, secret);
+        check(memcmp(sig, expect_sig, 64) == 0);
+
+        check(nectar_ed25519_decompress(&pk, pub) == 0);
+        check(nectar_ed25519_verify(sig, msg, len, pub) == 0);
+        check(nectar_ed25519_verify_decompressed(sig, msg, len, &pk) == 0);
+        sig[0] ^= 1;
+        check(nectar_ed25519_verify(sig, msg, len, pub) == -1);
+        check(nectar_ed25519_verify_decompressed(sig, msg, len, &pk) == -1);
+        sig[0] ^= 1;
+        sig[32] ^= 1;
+        check(nectar_ed25519_verify(sig, msg, len, pub) == -1);
+        check(nectar_ed25519_verify_decompressed(sig, msg, len, &pk) == -1);
+        sig[32] ^= 1;
+        if (len > 0) {
+            msg[len - 1] ^= 1;
+            check(nectar_ed25519_verify(sig, msg, len, pub) == -1);
+            check(nectar_ed25519_verify_decompressed(sig, msg, len, &pk) == -1);
+        }
+    }
+}
+
+
+/* The Ed25519ph test vector of RFC 8032, section 7.3, through both the
+ * one-shot and the streaming functions. */
+static void rfc8032ph(void) {
+    static const char * secret_hex =
+        "833fe62409237b9d62ec77587520911e9a759cec1d19755b7da901b96dca3d42";
+    static const char * pub_hex =
+        "ec172b93ad5e563bf4932c70e1245034c35467ef2efd4d64ebf819683467e2bf";
+    static const char * sig_hex =
+        "98a70222f0b8121aa9d30f813d683f809e462b469c7ff87639499bb94e6dae41"
+        "31f85042463c2a355a2003d062adf5aaa10b8c61e636062aaad11c2a26083406";
+    static const uint8_t msg[3] = { 'a', 'b', 'c' };
+    uint8_t secret[32], pub[32], sig[64], expect[64];
+    struct nectar_ed25519ph_ctx cx;
+    struct nectar_ed25519_sk sk;
+
+    unhex(secret, secret_hex);
+    unhex(pub, pub_hex);
+    unhex(expect, sig_hex);
+    nectar_ed25519_expand(&sk, secret);
+
+    nectar_ed25519ph_sign(sig, msg, 3, &sk);
+    check(memcmp(sig, expect, 64) == 0);
+    check(nectar_ed25519ph_verify(sig, msg, 3, pub) == 0);
+
+    memset(sig, 0, 64);
+    nectar_ed25519ph_init(&cx);
+    nectar_ed25519ph_update(&cx, msg, 1);
+    nectar_ed25519ph_update(&cx, msg + 1, 0);
+    nectar_ed25519ph_update(&cx, msg + 1, 2);
+    nectar_ed25519ph_sign_final(&cx, sig, &sk);
+    check(memcmp(sig, expect, 64) == 0);
+
+    nectar_ed25519ph_init(&cx);
+    nectar_ed25519ph_update(&cx, msg, 2);
+    nectar_ed25519ph_update(&cx, msg + 2, 1);
+    check(nectar_ed25519ph_verify_final(&cx, sig, pub) == 0);
+
+    /* Ed25519ph and plain Ed25519 signatures are not interchangeable. */
+    check(nectar_ed25519_verify(sig, msg, 3, pub) == -1);
+    sig[0] ^= 1;
+    check(nectar_ed25519ph_verify(sig, msg, 3, pub) == -1);
+    nectar_ed25519ph_init(&cx);
+    nectar_ed25519ph_update(&cx, msg, 3);
+    check(nectar_ed25519ph_verify_final(&cx, sig, pub) == -1);
+}
+
+
+/* Signing with an expanded key must give the same signatures as signing
+ * with the private key, for messages of any length. */
+static void expanded(void) {
+    uint8_t secret[32], pub[32], sig[64], expect[64], msg[200];
+    struct nectar_ed25519_sk sk;
+    size_t i, len;
+
+    for (i = 0; i < 16; i++) {
+        fill(secret, 32, (uint32_t) i);
+        fill(msg, sizeof(msg), (uint32_t) i + 100);
+        len = i * 13 % sizeof(msg);
+
+        nectar_ed25519_pubkey(pub, secret);
+        nectar_ed25519_expand(&sk, secret);
+        check(memcmp(sk.pub, pub, 32) == 0);
+
+        nectar_ed25519_sign(expect, msg, len, pub, secret);
+        nectar_ed25519_sign_expanded(sig, msg, len, &sk);
+        check(memcmp(sig, expect, 64) == 0);
+        check(nectar_ed25519_verify(sig, msg, len, pub) == 0);
+    }
+}
+
+
+/* Public keys generated in a batch must be the same as those generated one
+ * at a time, for batches around the chunk boundaries. */
+static void pubkeys(void) {
+    static const size_t sizes[] = { 0, 1, 31, 32, 33, 64, 70 };
+    static uint8_t secret[70][32], pub[71][32], expect[70][32];
+    size_t i, j, n;
+
+    for (i = 0; i < 70; i++) {
+        fill(secret[i], 32, (uint32_t) i + 3000);
+        nectar_ed25519_pubkey(expect[i], secret[i]);
+    }
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        n = sizes[i];
+        memset(pub, 0xaa, sizeof(pub));
+        nectar_ed25519_pubkey_batch(pub[0], secret[0], n);
+
+        for (j = 0; j < n; j++)
+            check(memcmp(pub[j], expect[j], 32) == 0);
+        for (j = 0; j < 32; j++)
+            check(pub[n][j] == 0xaa);
+    }
+}
+
+
+static uint8_t pub[MAXBATCH][32], sig[MAXBATCH][64], msg[MAXBATCH][64];
+static const uint8_t * data[MAXBATCH];
+static size_t lens[MAXBATCH];
+
+
+/* Verify the first n signatures in a batch, and check that each result is
+ * the same as that of a single verification. */
+static int verify_batch(size_t n) {
+    int out[MAXBATCH + 1];
+    size_t i;
+    int ret;
+
+    memset(out, 0x55, sizeof(out));
+    ret = nectar_ed25519_verify_batch(out, sig[0], data, lens, pub[0], n);
+
+    for (i = 0; i < n; i++)
+        check(out[i] == nectar_ed25519_verify(sig[i], data[i], lens[i], pub[i]));
+    check(out[n] == 0x55555555);
+
+    return ret;
+}
+
+
+/* Batches of valid signatures must pass as a whole, and a single bad
+ * signature or key must be singled out, in the first group or a later one. */
+static void batch(void) {
+    static const size_t sizes[] = { 0, 1, 2, 63, 64, 65, MAXBATCH };
+    static const size_t bad[] = { 0, 1, 100, MAXBATCH - 1 };
+    uint8_t secret[32], saved[64];
+    unsigned carry;
+    size_t i, j, k;
+
+    for (i = 0; i < MAXBATCH; i++) {
+        fill(secret, 32, (uint32_t) i + 1000);
+        fill(msg[i], 64, (uint32_t) i + 2000);
+        lens[i] = 1 + i % 64;
+        data[i] = msg[i];
+
+        nectar_ed25519_pubkey(pub[i], secret);
+        nectar_ed25519_sign(sig[i], msg[i], lens[i], pub[i], secret);
+    }
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        check(verify_batch(sizes[i]) == 0);
+
+    for (i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        k = bad[i];
+
+        /* A forged signature. */
+        msg[k][0] ^= 1;
+        check(verify_batch(MAXBATCH) == -1);
+        check(verify_batch(k + 1) == -1);
+        msg[k][0] ^= 1;
+
+        /* A public key that is not a valid point. */
+        memcpy(saved, pub[k], 32);
+        memset(pub[k], 0, 32);
+        pub[k][0] = 2;
+        check(verify_batch(MAXBATCH) == -1);
+        memcpy(pub[k], saved, 32);
+
+        /* S with its top bits set is rejected outright, while S + L is
+         * judged the same way in a batch as on its own. */
+        memcpy(saved, sig[k], 64);
+        sig[k][63] |= 0xe0;
+        check(verify_batch(MAXBATCH) == -1);
+        memcpy(sig[k], saved, 64);
+
+        for (j = 0, carry = 0; j < 32; j++) {
+            carry += (unsigned) sig[k][32 + j] + order[j];
+            sig[k][32 + j] = (uint8_t) carry;
+            carry >>= 8;
+        }
+        verify_batch(MAXBATCH);
+        memcpy(sig[k], saved, 64);
+    }
+
+    check(verify_batch(MAXBATCH) == 0);
+}
+
+
+int main(void) {
+    rfc8032();
+    rfc8032ph();
+    pubkeys();
+    expanded();
+    batch();
+    nectar_cpu_mask(0);
+    rfc8032();
+    rfc8032ph();
+    pubkeys();
+    expanded();
+    batch();
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Checks both field inversions against exponentiation by p - 2 (Fermat's
+ * little theorem), with a plain square-and-multiply over the exponent's bits,
+ * on random inputs and on edge cases around 0 and p. Run `make test` both with
+ * the default field arithmetic and with NECTAR_25519_FE32 to cover both
+ * backends. */
+#include <stdint.h>
+#include <string.h>
+
+#include "include/nectar.h"
+#include "src/25519/fe.h"
+#include "test/test.h"
+
+#define RANDOM 20000
+
+
+/* p - 2 = 2^255 - 21, in little-endian order. */
+static const uint8_t exponent[32] = {
+    0xeb, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f
+};
+
+/* Inputs as 32-byte little-endian strings. The top bit is ignored when
+ * decoding, so the last two are both 2^255 - 1. */
+static const char * edges[] = {
+    "0000000000000000000000000000000000000000000000000000000000000000",
+    "0100000000000000000000000000000000000000000000000000000000000000",
+    "ecffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+    "edffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+    "eeffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+    "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+    "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+    "0200000000000000000000000000000000000000000000000000000000000000",
+};
+
+
+static void fermat(fe out, const fe z) {
+    fe r;
+    int i;
+
+    fe_1(r);
+    for (i = 254; i >= 0; i--) {
+        fe_sq(r, r);
+        if ((exponent[i / 8] >> (i & 7)) & 1)
+            fe_mul(r, r, z);
+    }
+    fe_copy(out, r);
+}
+
+
+static void compare(const uint8_t s[32]) {
+    uint8_t expect[32], got[32];
+    fe z, r;
+
+    fe_frombytes(z, s);
+    fermat(r, z);
+    fe_tobytes(expect, r);
+
+    fe_invert(r, z);
+    fe_tobytes(got, r);
+    check(memcmp(got, expect, 32) == 0);
+
+    fe_invert_vartime(r, z);
+    fe_tobytes(got, r);
+    check(memcmp(got, expect, 32) == 0);
+
+    /* In place, as the library often does. */
+    fe_copy(r, z);
+    fe_invert(r, r);
+    fe_tobytes(got, r);
+    check(memcmp(got, expect, 32) == 0);
+}
+
+
+/* Inverting 0 gives 0, and 1 gives 1, independently of the reference. */
+static void fixed(void) {
+    uint8_t s[32], t[32];
+    fe z, r;
+
+    memset(s, 0, 32);
+    fe_frombytes(z, s);
+    fe_invert(r, z);
+    fe_tobytes(t, r);
+    check(memcmp(t, s, 32) == 0);
+
+    s[0] = 1;
+    fe_frombytes(z, s);
+    fe_invert_vartime(r, z);
+    fe_tobytes(t, r);
+    check(memcmp(t, s, 32) == 0);
+}
+
+
+int main(void) {
+    uint8_t s[32];
+    size_t i;
+
+    for (i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        unhex(s, edges[i]);
+        compare(s);
+    }
+
+    for (i = 0; i < RANDOM; i++) {
+        fill(s, 32, (uint32_t) i);
+        compare(s);
+    }
+
+    fixed();
+
+    return 0;
+}
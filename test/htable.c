@@ -0,0 +1,107 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Checks the hash table while it is being resized, when entries are split
+ * between the old and the new table: every key must stay reachable, updates
+ * and removals must find the right copy, and the length must stay exact. */
+#include <stdint.h>
+#include <string.h>
+
+#include "include/nectar.h"
+#include "test/test.h"
+
+#define N 3000
+
+static const uint8_t seed[16] = {
+    0x0f, 0x0e, 0x0d, 0x0c, 0x0b, 0x0a, 0x09, 0x08,
+    0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00
+};
+
+static uint8_t keys[N][40];
+static size_t lens[N];
+static int present[N];
+
+/* Value stored for key `i`, which changes when the key is updated. */
+static void * value(size_t i, int gen) {
+    return (void *) (uintptr_t) (i*4 + (size_t) gen + 1);
+}
+
+
+static void verify(const struct nectar_htable * ht, size_t upto) {
+    void * v;
+    size_t i;
+
+    for (i = 0; i < upto; i++) {
+        if (present[i]) {
+            check(nectar_htable_get(ht, keys[i], lens[i], &v) == 0);
+            check(v == value(i, present[i]));
+        } else {
+            check(nectar_htable_get(ht, keys[i], lens[i], NULL) == -1);
+        }
+    }
+}
+
+
+int main(void) {
+    struct nectar_htable ht;
+    size_t i, j, len = 0, resizing = 0;
+    void * v;
+
+    /* A mix of inline and out of line keys, made unique by their first two
+     * bytes. */
+    for (i = 0; i < N; i++) {
+        lens[i] = 2 + (i*7) % 39;
+        keys[i][0] = (uint8_t) i;
+        keys[i][1] = (uint8_t) (i >> 8);
+        fill(keys[i] + 2, lens[i] - 2, 1);
+    }
+
+    nectar_htable_init(&ht, seed);
+    for (i = 0; i < N; i++) {
+        check(nectar_htable_put(&ht, keys[i], lens[i], value(i, 1)) == 0);
+        present[i] = 1;
+        len++;
+
+        if (ht.old_cap == 0)
+            continue;
+        resizing++;
+
+        /* Update and remove some earlier keys while the old table is still
+         * being drained, then check everything inserted so far. */
+        j = (i*31) % (i + 1);
+        if (present[j] == 1) {
+            check(nectar_htable_put(&ht, keys[j], lens[j], value(j, 2)) == 0);
+            present[j] = 2;
+        }
+        j = (i*17) % (i + 1);
+        if (present[j]) {
+            check(nectar_htable_del(&ht, keys[j], lens[j], &v) == 0);
+            check(v == value(j, present[j]));
+            present[j] = 0;
+            len--;
+        }
+        check(nectar_htable_len(&ht) == len);
+        verify(&ht, i + 1);
+    }
+    check(resizing > 0);
+    check(nectar_htable_len(&ht) == len);
+    verify(&ht, N);
+
+    nectar_htable_free(&ht);
+    check(nectar_htable_len(&ht) == 0);
+    verify(&ht, 0);
+
+    return 0;
+}
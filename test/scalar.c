@@ -0,0 +1,129 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Checks the scalar arithmetic built into the library against the 21-bit
+ * implementation in sc.c, compiled in here under other names, on random
+ * inputs and on edge cases around 0, l and 2^512 - 1. With NECTAR_25519_SC32
+ * both are the same code. */
+#include <stdint.h>
+#include <string.h>
+
+#include "include/nectar.h"
+#include "src/25519/sc.h"
+#include "test/test.h"
+
+#define RANDOM 100000
+
+
+static void (* const lib_reduce)(uint8_t *) = sc_reduce;
+static void (* const lib_muladd)(uint8_t *, const uint8_t *, const uint8_t *,
+                                 const uint8_t *) = sc_muladd;
+
+#undef NECTAR_25519_SC64
+#undef sc_muladd
+#undef sc_reduce
+#define sc_muladd  ref_sc_muladd
+#define sc_reduce  ref_sc_reduce
+#include "src/25519/sc.c"
+
+
+/* l, and l - 1, in little-endian order. */
+static const uint8_t order[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+    0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+static const uint8_t order_1[32] = {
+    0xec, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+    0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+
+static void reduce(const uint8_t in[64]) {
+    uint8_t a[64], b[64];
+
+    memcpy(a, in, 64);
+    memcpy(b, in, 64);
+    lib_reduce(a);
+    ref_sc_reduce(b);
+    check(memcmp(a, b, 32) == 0);
+}
+
+
+static void muladd(const uint8_t * x, const uint8_t * y, const uint8_t * z) {
+    uint8_t a[32], b[32];
+
+    lib_muladd(a, x, y, z);
+    ref_sc_muladd(b, x, y, z);
+    check(memcmp(a, b, 32) == 0);
+}
+
+
+static void fixed(void) {
+    const uint8_t * edges[5];
+    uint8_t zero[64], one[32], ones[64], buf[64];
+    size_t i, j, k;
+
+    memset(zero, 0, 64);
+    memset(one, 0, 32);
+    one[0] = 1;
+    memset(ones, 0xff, 64);
+
+    edges[0] = zero;
+    edges[1] = one;
+    edges[2] = order_1;
+    edges[3] = order;
+    edges[4] = ones;
+
+    reduce(zero);
+    reduce(ones);
+    for (i = 0; i < 5; i++) {
+        for (j = 0; j < 5; j++) {
+            memcpy(buf, edges[i], 32);
+            memcpy(buf + 32, edges[j], 32);
+            reduce(buf);
+
+            for (k = 0; k < 5; k++)
+                muladd(edges[i], edges[j], edges[k]);
+        }
+    }
+}
+
+
+int main(void) {
+    uint8_t buf[128];
+    uint32_t i;
+
+    fixed();
+
+    for (i = 0; i < RANDOM; i++) {
+        fill(buf, 128, i);
+        reduce(buf);
+        muladd(buf, buf + 32, buf + 64);
+
+        /* Inputs with the top bits set. */
+        memset(buf + 24, 0xff, 8);
+        memset(buf + 56, 0xff, 8);
+        memset(buf + 88, 0xff, 8);
+        reduce(buf);
+        muladd(buf, buf + 32, buf + 64);
+    }
+
+    return 0;
+}
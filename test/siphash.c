@@ -0,0 +1,115 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Checks the SipHash batch function against the scalar one, with inputs of
+ * mixed lengths ending right before an unmapped page, and in heap buffers of
+ * exactly their own size. */
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "include/nectar.h"
+#include "test/test.h"
+
+#define MAXLEN 80
+#define N      37
+
+static const uint8_t seed[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+
+
+static void compare(const uint8_t * const * data, const size_t * lens, size_t n) {
+    uint64_t out[N];
+    size_t i;
+
+    nectar_siphash_batch(seed, data, lens, out, n);
+    for (i = 0; i < n; i++)
+        check(out[i] == nectar_siphash(seed, data[i], lens[i]));
+}
+
+
+/* Every input ends at the first byte of a page which is not mapped, so that
+ * reading past the end of any of them faults. */
+static void guarded(void) {
+    const uint8_t * data[N];
+    size_t lens[N], page, i;
+    uint8_t * mem;
+
+    page = (size_t) sysconf(_SC_PAGESIZE);
+    mem = mmap(NULL, 2*page, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    check(mem != MAP_FAILED);
+    check(mprotect(mem + page, page, PROT_NONE) == 0);
+    fill(mem, page, 1);
+
+    /* Lengths that differ within every group of four. */
+    for (i = 0; i < N; i++) {
+        lens[i] = (i*29 + i/4) % (MAXLEN + 1);
+        data[i] = mem + page - lens[i];
+    }
+    compare(data, lens, N);
+
+    /* One long input among short ones, in every lane. */
+    for (i = 0; i < N; i++) {
+        lens[i] = i % 8;
+        data[i] = mem + page - lens[i];
+    }
+    for (i = 0; i < 4; i++) {
+        lens[i] = MAXLEN;
+        data[i] = mem + page - MAXLEN;
+        compare(data, lens, 4);
+        lens[i] = i;
+        data[i] = mem + page - i;
+    }
+
+    munmap(mem, 2*page);
+}
+
+
+/* The same, with each input in a heap buffer of exactly its length. */
+static void heap(void) {
+    const uint8_t * data[N];
+    uint8_t * bufs[N];
+    size_t lens[N], i;
+
+    for (i = 0; i < N; i++) {
+        lens[i] = (i*13 + 1) % (MAXLEN + 1);
+        bufs[i] = malloc(lens[i] ? lens[i] : 1);
+        check(bufs[i] != NULL);
+        fill(bufs[i], lens[i], (uint32_t) i);
+        data[i] = bufs[i];
+    }
+    for (i = 0; i <= N; i++)
+        compare(data, lens, i);
+    for (i = 0; i < N; i++)
+        free(bufs[i]);
+}
+
+
+int main(void) {
+    guarded();
+    heap();
+
+    nectar_cpu_mask(0);
+    guarded();
+    heap();
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Checks that `nectar_stats_snapshot` adds up the counts of every thread:
+ * the main thread, threads still running, threads that have exited, and
+ * counts made from thread-specific data destructors after the library has
+ * taken a thread's block back. Without NECTAR_STATS it only checks that the
+ * snapshot is empty; run `make FLAGS=-DNECTAR_STATS test` for the rest. */
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "include/nectar.h"
+#include "test/test.h"
+
+#define THREADS  4
+#define CALLS    100
+#define LATE     7
+#define LEN      40
+
+static pthread_key_t key;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static int counted, finish;
+
+
+static void hash(int n) {
+    uint8_t seed[16], data[LEN];
+    int i;
+
+    memset(seed, 1, 16);
+    memset(data, 2, LEN);
+    for (i = 0; i < n; i++)
+        nectar_siphash(seed, data, LEN);
+}
+
+
+/* Count some more as the thread exits. */
+static void late(void * p) {
+    (void) p;
+    hash(LATE);
+}
+
+
+static void * exiting(void * p) {
+    (void) p;
+    pthread_setspecific(key, &key);
+    hash(CALLS);
+
+    return NULL;
+}
+
+
+/* Count, then wait until the main thread has taken a snapshot. */
+static void * running(void * p) {
+    (void) p;
+    hash(CALLS);
+
+    pthread_mutex_lock(&lock);
+    counted++;
+    pthread_cond_broadcast(&cond);
+    while (!finish)
+        pthread_cond_wait(&cond, &lock);
+    pthread_mutex_unlock(&lock);
+
+    return NULL;
+}
+
+
+/* Check the counts added since `base`. */
+static void expect(const struct nectar_stats * base, uint64_t calls) {
+    static struct nectar_stats st;
+    const struct nectar_stats_primitive * p, * q;
+
+    check(nectar_stats_snapshot(&st) == 0);
+    p = &st.primitive[NECTAR_STATS_SIPHASH];
+    q = &base->primitive[NECTAR_STATS_SIPHASH];
+
+    check(p->calls - q->calls == calls);
+    check(p->bytes - q->bytes == calls * LEN);
+    check(p->sizes[6] - q->sizes[6] == calls);
+}
+
+
+int main(void) {
+    static struct nectar_stats base;
+    pthread_t t[THREADS];
+    size_t i;
+
+    if (nectar_stats_snapshot(&base) != 0) {
+        for (i = 0; i < sizeof(base); i++)
+            check(((uint8_t *) &base)[i] == 0);
+        return 0;
+    }
+
+    check(pthread_key_create(&key, late) == 0);
+
+    hash(CALLS);
+    expect(&base, CALLS);
+
+    /* Threads that have exited. Their blocks are reused by the next ones. */
+    for (i = 0; i < THREADS; i++)
+        check(pthread_create(&t[i], NULL, exiting, NULL) == 0);
+    for (i = 0; i < THREADS; i++)
+        check(pthread_join(t[i], NULL) == 0);
+    expect(&base, CALLS + THREADS * (CALLS + LATE));
+
+    /* Threads still running. */
+    for (i = 0; i < THREADS; i++)
+        check(pthread_create(&t[i], NULL, running, NULL) == 0);
+
+    pthread_mutex_lock(&lock);
+    while (counted < THREADS)
+        pthread_cond_wait(&cond, &lock);
+    pthread_mutex_unlock(&lock);
+
+    expect(&base, CALLS + THREADS * (2*CALLS + LATE));
+
+    pthread_mutex_lock(&lock);
+    finish = 1;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+
+    for (i = 0; i < THREADS; i++)
+        check(pthread_join(t[i], NULL) == 0);
+    expect(&base, CALLS + THREADS * (2*CALLS + LATE));
+
+    /* And once more with the blocks of all of them free. */
+    for (i = 0; i < THREADS; i++)
+        check(pthread_create(&t[i], NULL, exiting, NULL) == 0);
+    for (i = 0; i < THREADS; i++)
+        check(pthread_join(t[i], NULL) == 0);
+    expect(&base, CALLS + THREADS * (3*CALLS + 2*LATE));
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+
+/* Shared helpers for the tests. Each test is a standalone program linked with
+ * the static library, which exits with status 1 after printing the location of
+ * the first failed check. Functions with several implementations are tested
+ * once with all the CPU features in use and once with the portable code. */
+#ifndef NECTAR_TEST_H
+#define NECTAR_TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define check(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+/* Deterministic filler for test inputs. */
+static inline void fill(uint8_t * buf, size_t len, uint32_t seed) {
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        seed = seed*1103515245 + 12345;
+        buf[i] = (uint8_t) (seed >> 16);
+    }
+}
+
+
+/* Decode a hex string (of even length) into `out`, returning its length. */
+static inline size_t unhex(uint8_t * out, const char * hex) {
+    size_t i;
+    int hi, lo;
+
+    for (i = 0; hex[2*i] != '\0' && hex[2*i + 1] != '\0'; i++) {
+        hi = hex[2*i] <= '9' ? hex[2*i] - '0' : (hex[2*i] | 0x20) - 'a' + 10;
+        lo = hex[2*i + 1] <= '9' ? hex[2*i + 1] - '0' : (hex[2*i + 1] | 0x20) - 'a' + 10;
+        out[i] = (uint8_t) (hi << 4 | lo);
+    }
+
+    return i;
+}
+
+#endif
@@ -0,0 +1,185 @@
+/* Copyright (c) 2015, Erik Lundin.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+ * OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE. */
+
+/* Generator for the table of base point multiples used by ge_scalarmult_base.
+ *
+ * Usage: basetable <window> <passes>
+ *
+ * The scalar is split into signed digits of `window` bits, and the digits are
+ * added in `passes` interleaved passes, with `window` doublings in between.
+ * Row i of the table then holds j * 2^(window * passes * i) * B for j from 1
+ * to 2^(window - 1), in the form expected by ge_madd. Wider windows need fewer
+ * additions, and more passes need fewer rows but more doublings. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/25519/fe.h"
+
+
+/* Affine coordinates of the base point, and the curve constant d. */
+static const uint8_t BX[32] = {
+    0x1a, 0xd5, 0x25, 0x8f, 0x60, 0x2d, 0x56, 0xc9, 0xb2, 0xa7, 0x25, 0x95, 0x60, 0xc7, 0x2c, 0x69,
+    0x5c, 0xdc, 0xd6, 0xfd, 0x31, 0xe2, 0xa4, 0xc0, 0xfe, 0x53, 0x6e, 0xcd, 0xd3, 0x36, 0x69, 0x21
+};
+
+static const uint8_t BY[32] = {
+    0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66
+};
+
+static const uint8_t D[32] = {
+    0xa3, 0x78, 0x59, 0x13, 0xca, 0x4d, 0xeb, 0x75, 0xab, 0xd8, 0x41, 0x41, 0x4d, 0x0a, 0x70, 0x00,
+    0x98, 0xe8, 0x79, 0x77, 0x79, 0x40, 0xc7, 0x8c, 0x73, 0xfe, 0x6f, 0x2b, 0xee, 0x6c, 0x03, 0x52
+};
+
+struct point {
+    fe x, y;
+};
+
+static fe d;
+
+
+/* Add two points in affine coordinates. The Edwards addition law is complete,
+ * so this also doubles. */
+static void add(struct point * r, const struct point * p, const struct point * q) {
+    struct point s;
+    fe a, b, t, u;
+
+    fe_mul(t, p->x, q->x);
+    fe_mul(u, p->y, q->y);
+    fe_mul(a, t, u);
+    fe_mul(a, a, d);
+
+    fe_1(b);
+    fe_sub(b, b, a);
+    fe_invert(b, b);
+    fe_add(s.y, u, t);
+    fe_mul(s.y, s.y, b);
+
+    fe_1(b);
+    fe_add(b, b, a);
+    fe_invert(b, b);
+    fe_mul(t, p->x, q->y);
+    fe_mul(u, p->y, q->x);
+    fe_add(s.x, t, u);
+    fe_mul(s.x, s.x, b);
+
+    *r = s;
+}
+
+
+/* Print a field element as the ten signed limbs taken by the FE macro, with
+ * alternating 26 and 25 bits, each brought within half its range. */
+static void print(const fe f) {
+    static const int pos[10] = { 0, 26, 51, 77, 102, 128, 153, 179, 204, 230 };
+    uint8_t s[32];
+    int64_t h[10];
+    int64_t w;
+    int i, j;
+
+    fe_tobytes(s, f);
+
+    for (i = 0; i < 10; i++) {
+        w = (i & 1) ? 25 : 26;
+        h[i] = 0;
+        for (j = pos[i] + (int) w - 1; j >= pos[i]; j--)
+            h[i] = (h[i] << 1) | ((s[j >> 3] >> (j & 7)) & 1);
+    }
+
+    for (i = 0; i < 10; i++) {
+        w = (i & 1) ? 25 : 26;
+        if (h[i] >= ((int64_t) 1 << (w - 1))) {
+            h[i] -= (int64_t) 1 << w;
+            if (i < 9)
+                h[i + 1] += 1;
+            else
+                h[0] += 19;
+        }
+    }
+
+    printf("   FE( ");
+    for (i = 0; i < 10; i++)
+        printf("%s%lld", i ? "," : "", (long long) h[i]);
+    printf(" ),\n");
+}
+
+
+int main(int argc, char ** argv) {
+    struct point p, q;
+    fe t, u;
+    int window, passes, digits, rows, entries;
+    int i, j;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <window> <passes>\n", argv[0]);
+        return 1;
+    }
+
+    window = atoi(argv[1]);
+    passes = atoi(argv[2]);
+
+    /* Digits are stored in an int8_t, and may reach 2^(window - 1). */
+    if (window < 2 || window > 7 || passes < 1 || passes > 8) {
+        fprintf(stderr, "%s: need 2 <= window <= 7 and 1 <= passes <= 8\n", argv[0]);
+        return 1;
+    }
+
+    digits = (256 + window - 1) / window;
+    rows = (digits + passes - 1) / passes;
+    entries = 1 << (window - 1);
+
+    fe_frombytes(d, D);
+    fe_frombytes(p.x, BX);
+    fe_frombytes(p.y, BY);
+
+    printf("/* Generated by tools/basetable.c with window %d and %d passes. */\n\n",
+           window, passes);
+    printf("#define BASE_WINDOW   %d\n", window);
+    printf("#define BASE_PASSES   %d\n", passes);
+    printf("#define BASE_ROWS     %d\n", rows);
+    printf("#define BASE_ENTRIES  %d\n\n", entries);
+    printf("static const ge_precomp base[BASE_ROWS][BASE_ENTRIES] = {\n");
+
+    for (i = 0; i < rows; i++) {
+        printf(" {\n");
+
+        q = p;
+        for (j = 0; j < entries; j++) {
+            if (j > 0)
+                add(&q, &q, &p);
+
+            fe_add(t, q.y, q.x);
+            fe_sub(u, q.y, q.x);
+
+            printf("  {\n");
+            print(t);
+            print(u);
+            fe_mul(t, q.x, q.y);
+            fe_mul(t, t, d);
+            fe_add(t, t, t);
+            print(t);
+            printf("  },\n");
+        }
+
+        printf(" },\n");
+
+        for (j = 0; j < window * passes; j++)
+            add(&p, &p, &p);
+    }
+
+    printf("} ;\n");
+
+    return 0;
+}